@@ -16,147 +16,168 @@
 
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 #include <k4arecord/playback.h>
 #include <k4a/k4a.h>
 
 #include <BodyTrackingHelpers.h>
-#include <Utilities.h>
 #include <Window3dWrapper.h>
 
 #include "imgui_dx11.h"
 #include "imgui_internal.h"
 
-#include "vec.h"
+#include "BoundedQueue.h"
+#include "Mailbox.h"
+#include "SessionStatistics.h"
+#include "SkeletonOutput.h"
+#include "CaptureSource.h"
+#include "BodyTracker.h"
+#include "SyntheticCapture.h"
 #include "3DViewer.h"
 
 // Global State and Key Process Function
 bool s_isRunning = true;
 Visualization::Layout3d s_layoutMode = Visualization::Layout3d::OnlyMainView;
 bool s_visualizeJointFrame = false;
+std::atomic<bool> s_headless(false);
 
-// Convert three passed points into an angle between the vectors p2 to p1 and p2 to p3
-float threePointsToAngle(k4a_float3_t& p1, k4a_float3_t& p2, k4a_float3_t& p3) {
-    vec vec1(p2, p1);
-    vec vec2(p2, p3);
+// Pipeline queue sizes and wait times
+const size_t CAPTURE_QUEUE_SIZE = 8; // Decoded captures waiting for the tracker
+const size_t PENDING_QUEUE_SIZE = 64; // Frames enqueued in the tracker waiting for their result to be consumed
+const int DEVICE_WAIT_MS = 250; // Time to wait for a device capture before checking if the pipeline was stopped
+const int RESULT_WAIT_MS = 100; // Time to wait for a frame from the feeder before checking the run time
 
-    float dotProduct = vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
-    float vec1Mag = sqrtf(vec1.x * vec1.x + vec1.y * vec1.y + vec1.z * vec1.z);
-    float vec2Mag = sqrtf(vec2.x * vec2.x + vec2.y * vec2.y + vec2.z * vec2.z);
+// Body index map values are 8-bit, so the point cloud palette has an entry for each of them
+const size_t BODY_INDEX_COLOR_COUNT = 256;
 
-    // Use formula for getting angle between two vectors and convert result to degrees
-    float res = acosf(dotProduct / (vec1Mag * vec2Mag)) * 180 / (float) M_PI;
-
-    return res;
+// Print an error and show it in a message box, unless no windows are being shown
+void reportError(const std::string& errorText) {
+    printf("%s\n", errorText.c_str());
+    if(!s_headless) {
+        MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
+    }
 }
 
-// Output joint angles from a passed skeleton 
-void getJointAngles(uint32_t id, k4abt_skeleton_t& skeleton, std::ofstream& outputFile, int processedFrames, double timeSinceStart) {
-    // Calculate joint angles
-    float leftElbowAngle = threePointsToAngle(skeleton.joints[K4ABT_JOINT_WRIST_LEFT].position,
-                                              skeleton.joints[K4ABT_JOINT_ELBOW_LEFT].position,
-                                              skeleton.joints[K4ABT_JOINT_SHOULDER_LEFT].position);
-    float rightElbowAngle = threePointsToAngle(skeleton.joints[K4ABT_JOINT_WRIST_RIGHT].position,
-                                               skeleton.joints[K4ABT_JOINT_ELBOW_RIGHT].position,
-                                               skeleton.joints[K4ABT_JOINT_SHOULDER_RIGHT].position);
-    float leftKneeAngle = threePointsToAngle(skeleton.joints[K4ABT_JOINT_HIP_LEFT].position,
-                                             skeleton.joints[K4ABT_JOINT_KNEE_LEFT].position,
-                                             skeleton.joints[K4ABT_JOINT_ANKLE_LEFT].position);
-    float rightKneeAngle = threePointsToAngle(skeleton.joints[K4ABT_JOINT_HIP_RIGHT].position,
-                                              skeleton.joints[K4ABT_JOINT_KNEE_RIGHT].position,
-                                              skeleton.joints[K4ABT_JOINT_ANKLE_RIGHT].position);
-
-    // Display joint angles and write them to a file
-    ImGui::Text(u8"  Left elbow angle: %f\n", leftElbowAngle);
-    ImGui::Text(u8"  Right elbow angle: %f\n", rightElbowAngle);
-    ImGui::Text(u8"  Left knee angle: %f\n", leftKneeAngle);
-    ImGui::Text(u8"  Right knee angle: %f\n", rightKneeAngle);
-
-    outputFile << processedFrames << "," << timeSinceStart << "," << id << ","
-               << leftElbowAngle << "," << rightElbowAngle << ","
-               << leftKneeAngle << "," << rightKneeAngle << ",";
-
-    // Write joint positions and distance from sensor to output file
+// Output a body's record with its angles, which are in the order of the angle table or NULL if the output calculates them
+void writeSkeletonRecord(uint32_t id, const k4abt_skeleton_t& skeleton, const float* angles, size_t angleCount, SkeletonOutput& outputFile,
+                         int processedFrames, uint64_t deviceTimestamp, uint64_t systemTimestamp, double timeSinceStart) {
+    SkeletonRecord record;
+    record.Frame = processedFrames;
+    record.BodyId = id;
+    record.DeviceTimestampUsec = deviceTimestamp;
+    record.SystemTimestampNsec = systemTimestamp;
+    record.Time = timeSinceStart;
+    // Only binary records keep angles, and CSV output with a filter calculates its own
+    SetSkeletonRecordAngles(record, angles, angleCount);
+
+    // Copy joint data to the record and write it
     for(int i = 0; i < K4ABT_JOINT_COUNT; ++i) {
-        // Convert joint position values from millimeters to meters
-        for(int j = 0; j < 3; ++j) {
-            skeleton.joints[i].position.v[j] /= 1000;
-        }
-
-        k4abt_joint_t curJoint = skeleton.joints[i];
-        k4a_float3_t::_xyz curJointPos = curJoint.position.xyz;
-
-        float distFromSensor = sqrtf(curJointPos.x * curJointPos.x +
-                                     curJointPos.y * curJointPos.y +
-                                     curJointPos.z * curJointPos.z);
-
-        outputFile << "\"<" << curJointPos.x << ", " << curJointPos.y 
-                   << ", " << curJointPos.z << ">, " << distFromSensor
-                   << ":" << curJoint.confidence_level << "\",";
+        const k4abt_joint_t& joint = skeleton.joints[i];
+        memcpy(record.Joints[i].Position, joint.position.v, sizeof(record.Joints[i].Position));
+        memcpy(record.Joints[i].Orientation, joint.orientation.v, sizeof(record.Joints[i].Orientation));
+        record.Joints[i].Confidence = joint.confidence_level;
     }
 
-    outputFile << std::endl;
+    outputFile.Write(record, angles);
 }
 
-// Attempt to open output file and write the first line
-void initOutputFile(std::ofstream& outputFile, std::string& outputFileName) {
-    outputFile.open(outputFileName);
-
-    if(outputFile.is_open()) {
-        printf("Open file %s succeeded.\n", outputFileName.c_str());
+// Attempt to open the output file in CSV or binary format and write its header. The angles written to it are added to statistics.
+bool initOutputFile(SkeletonOutput& outputFile, InputSettings& inputSettings, const k4a_calibration_t& calibration, const std::vector<uint8_t>& rawCalibration,
+                    SessionStatistics* statistics) {
+    if(outputFile.Open(inputSettings.OutputFileName, inputSettings.BinaryOutput, GetSkeletonCsvOptions(inputSettings),
+                       calibration, rawCalibration, statistics)) {
+        printf("Open file %s succeeded.\n", inputSettings.OutputFileName.c_str());
     }
     else {
-        std::string errorText = "Open file " + outputFileName + " failed.";
-        printf("%s\n", errorText.c_str());
-        MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
-        s_isRunning = false; // Stop data collection from running
-    }
-
-    // Write column names to output file
-    outputFile << "Frame,Time,ID,Left Elbow Angle,Right Elbow Angle,Left Knee "
-               << "Angle,Right Knee Angle,Pelvis Pos,SpineNavel Pos,"
-               << "SpineChest Pos,Neck Pos,ClavicleLeft Pos,ShoulderLeft Pos,"
-               << "ElbowLeft Pos,WristLeft Pos,HandLeft Pos,HandTipLeft Pos,"
-               << "ThumbLeft Pos,ClavicleRight Pos,ShoulderRight Pos,"
-               << "ElbowRight Pos,WristRight Pos,HandRight Pos,HandTipRight "
-               << "Pos,ThumbRight Pos,HipLeft Pos,KneeLeft Pos,AnkleLeft Pos,"
-               << "FootLeft Pos,HipRight Pos,KneeRight Pos,AnkleRight Pos,"
-               << "FootRight Pos,Head Pos,Nose Pos,EyeLeft Pos,EarLeft Pos,"
-               << "EyeRight Pos,EarRight Pos" << std::endl;
+        std::string errorText = "Open file " + inputSettings.OutputFileName + " failed.";
+        reportError(errorText);
+        return false;
+    }
+
+    return true;
 }
 
-// Display body and angle information from frame
-void processFrame(k4abt_frame_t& bodyFrame, std::ofstream& outputFile, int& processedFrames, std::chrono::high_resolution_clock::time_point& startTime, bool emptyLines) {
-    size_t num_bodies = k4abt_frame_get_num_bodies(bodyFrame);
+// Angles of a body shown in the data window
+struct BodyDisplayInfo {
+    uint32_t Id = 0;
+    std::vector<float> Angles; // In the order of the angle table
+};
+
+// Body and angle information of a processed frame shown in the data window
+struct FrameDisplayInfo {
+    int ProcessedFrames = 0;
+    double TimeSinceStart = 0.0;
+    std::vector<BodyDisplayInfo> Bodies; // Keeps its memory for the next frame
+};
+
+// Write every body in frame with its angles, and keep what the data window shows in displayInfo if it is not NULL.
+// Angles are calculated once for all bodies, and only if the output or the data window uses them; the output
+// calculates its own from filtered joints and adds the angles it writes to the session statistics.
+void processFrame(BodyFrame& frame, JointAngleCalculator& angles, SkeletonOutput& outputFile, int& processedFrames,
+                  int64_t& firstDeviceTimestamp, bool emptyLines, FrameDisplayInfo* displayInfo) {
+    size_t num_bodies = frame.Bodies.size();
+    size_t angleCount = angles.Table().Count();
+    uint64_t deviceTimestamp = frame.DeviceTimestampUsec;
+    uint64_t systemTimestamp = frame.SystemTimestampNsec;
     processedFrames++;
-    auto curTime = std::chrono::high_resolution_clock::now();
 
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(curTime - startTime);
-    double timeSinceStart = duration.count() / 1000.0;
+    // Measure time from the depth image timestamps, so it does not depend on how fast frames are processed
+    if(firstDeviceTimestamp < 0) {
+        firstDeviceTimestamp = (int64_t) deviceTimestamp;
+    }
+    double timeSinceStart = ((int64_t) deviceTimestamp - firstDeviceTimestamp) / 1000000.0;
 
-    // Start ImGui window
-    ImGui::Begin("Data", (bool*) 0, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
-    ImGui::Text("Bodies detected: %zu", num_bodies);
-    ImGui::Text("Frames processed: %d", processedFrames);
-    ImGui::Text("Time: %.3f s", timeSinceStart);
+    if(displayInfo != NULL) {
+        displayInfo->ProcessedFrames = processedFrames;
+        displayInfo->TimeSinceStart = timeSinceStart;
+        displayInfo->Bodies.resize(num_bodies);
+    }
 
     if (emptyLines && num_bodies == 0) {
-        outputFile << processedFrames << ",," << std::endl;
+        outputFile.Write(EmptySkeletonRecord(processedFrames, deviceTimestamp, systemTimestamp, timeSinceStart), NULL);
+    }
+
+    // Calculate the angles of all bodies at once
+    bool hasAngles = displayInfo != NULL || outputFile.UsesRecordAngles();
+    if(hasAngles) {
+        angles.Compute(frame.Bodies.data(), num_bodies);
     }
 
     // Process each detected body
-    for(uint32_t i = 0; i < num_bodies; i++) {
-        // Get and display data from current body
-        uint32_t id = k4abt_frame_get_body_id(bodyFrame, i);
-        k4abt_skeleton_t skeleton;
-        k4abt_frame_get_body_skeleton(bodyFrame, i, &skeleton);
+    for(size_t i = 0; i < num_bodies; ++i) {
+        k4abt_body_t& body = frame.Bodies[i];
+        const float* bodyAngles = hasAngles ? angles.Angles(i) : NULL;
+        if(displayInfo != NULL) {
+            displayInfo->Bodies[i].Id = body.id;
+            displayInfo->Bodies[i].Angles.assign(bodyAngles, bodyAngles + angleCount);
+        }
+        writeSkeletonRecord(body.id, body.skeleton, bodyAngles, angleCount, outputFile, processedFrames, deviceTimestamp, systemTimestamp, timeSinceStart);
+    }
+}
+
+// Display body and angle information of a processed frame in the current ImGui window
+void showFrameInfo(const FrameDisplayInfo& displayInfo, const JointAngleTable& angleTable) {
+    ImGui::Text("Bodies detected: %zu", displayInfo.Bodies.size());
+    ImGui::Text("Frames processed: %d", displayInfo.ProcessedFrames);
+    ImGui::Text("Time: %.3f s", displayInfo.TimeSinceStart);
 
+    for(const BodyDisplayInfo& body : displayInfo.Bodies) {
+        // Display data from current body
         ImGui::Separator();
-        ImGui::Text("Body %d:", id);
-        getJointAngles(id, skeleton, outputFile, processedFrames, timeSinceStart);
+        ImGui::Text("Body %u:", body.Id);
+        for(size_t i = 0; i < body.Angles.size() && i < angleTable.Count(); i++) {
+            if(IsJointAngleValid(body.Angles[i])) {
+                ImGui::Text(u8"  %s angle: %f\n", angleTable[i].Name.c_str(), body.Angles[i]);
+            }
+            else {
+                ImGui::Text("  %s angle: not tracked\n", angleTable[i].Name.c_str());
+            }
+        }
     }
-
-    ImGui::End();
 }
 
 // Process 3D viewer window key inputs
@@ -186,37 +207,21 @@ int64_t CloseCallback(void* /*context*/) {
     return 1;
 }
 
-// Display graphics in the 3D viewer window
-void VisualizeResult(k4abt_frame_t bodyFrame, Window3dWrapper& window3d, int depthWidth, int depthHeight) {
-    // Obtain original capture that generates the body tracking result
-    k4a_capture_t originalCapture = k4abt_frame_get_capture(bodyFrame);
-    k4a_image_t depthImage = k4a_capture_get_depth_image(originalCapture);
-
-    std::vector<Color> pointCloudColors(depthWidth * depthHeight, {1.f, 1.f, 1.f, 1.f});
-
-    // Read body index map and assign colors
-    k4a_image_t bodyIndexMap = k4abt_frame_get_body_index_map(bodyFrame);
-    const uint8_t* bodyIndexMapBuffer = k4a_image_get_buffer(bodyIndexMap);
-    for(int i = 0; i < depthWidth * depthHeight; i++) {
-        uint8_t bodyIndex = bodyIndexMapBuffer[i];
-        if(bodyIndex != K4ABT_BODY_INDEX_MAP_BACKGROUND) {
-            uint32_t bodyId = k4abt_frame_get_body_id(bodyFrame, bodyIndex);
-            pointCloudColors[i] = g_bodyColors[bodyId % g_bodyColors.size()];
-        }
+// Display graphics in the 3D viewer window. The body index palette is kept by the caller so it is only allocated once.
+void VisualizeResult(BodyFrame& frame, Window3dWrapper& window3d, std::vector<Color>& bodyIndexColors) {
+    // Assign a color to each body index. Unused indices and the background stay white.
+    bodyIndexColors.assign(BODY_INDEX_COLOR_COUNT, {1.f, 1.f, 1.f, 1.f});
+    for(size_t i = 0; i < frame.Bodies.size() && i < K4ABT_BODY_INDEX_MAP_BACKGROUND; i++) {
+        uint32_t bodyId = frame.Bodies[i].id;
+        bodyIndexColors[i] = g_bodyColors[bodyId % g_bodyColors.size()];
     }
-    k4a_image_release(bodyIndexMap);
 
-    // Visualize point cloud
-    window3d.UpdatePointClouds(depthImage, pointCloudColors);
+    // Visualize point cloud, coloring points by looking up their body index map value
+    window3d.UpdatePointClouds(frame.DepthImage, frame.BodyIndexMap, bodyIndexColors);
 
     // Visualize the skeleton data
     window3d.CleanJointsAndBones();
-    uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
-    for(uint32_t i = 0; i < numBodies; i++) {
-        k4abt_body_t body;
-        VERIFY(k4abt_frame_get_body_skeleton(bodyFrame, i, &body.skeleton), "Get skeleton from body frame failed!");
-        body.id = k4abt_frame_get_body_id(bodyFrame, i);
-
+    for(const k4abt_body_t& body : frame.Bodies) {
         // Assign the correct color based on the body id
         Color color = g_bodyColors[body.id % g_bodyColors.size()];
         color.a = 0.4f;
@@ -250,158 +255,275 @@ void VisualizeResult(k4abt_frame_t bodyFrame, Window3dWrapper& window3d, int dep
             }
         }
     }
-
-    k4a_capture_release(originalCapture);
-    k4a_image_release(depthImage);
 }
 
-// Run body tracking data collection on a pre-recorded video file
-void PlayFile(InputSettings inputSettings) {
-    // Initialize the 3d window controller
-    Window3dWrapper window3d;
-
-    // Create the tracker and playback handle
-    k4a_calibration_t sensor_calibration;
-    k4abt_tracker_t tracker = NULL;
-    k4a_playback_t playback_handle = NULL;
-
-    // Attempt to open pre-recorded video file
-    const char* inputFileName = inputSettings.InputFileName.c_str();
-    if(k4a_playback_open(inputFileName, &playback_handle) != K4A_RESULT_SUCCEEDED) {
-        std::string errorText = "Failed to open recording: " + std::string(inputFileName);
-        printf("%s\n", errorText.c_str());
-        MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
+// Counters for the tracker results of a capture session
+struct ResultStats {
+    uint64_t ResultsPopped = 0;
+    uint64_t FramesNotShown = 0; // Replaced by a newer frame before the render loop took them
+    uint64_t LatencyCount = 0;
+    double LatencySumMs = 0.0;
+    double LatencyMaxMs = 0.0;
+    double LastLatencyMs = 0.0;
+};
+
+// Counters for a capture session
+struct CaptureStats {
+    // Updated by the reader thread
+    std::atomic<uint64_t> CapturesReceived{0};
+    std::atomic<uint64_t> CapturesMissed{0}; // Estimated from gaps between device timestamps
+    // Dropped because the tracker was falling behind, by the reader when the capture queue is full
+    // or by the feeder when the tracker's input queue is full
+    std::atomic<uint64_t> CapturesDropped{0};
+
+    // Updated by the result consumer. The render loop shows the copy posted with each frame.
+    ResultStats Results;
+    // Updated by the output as rows are written, and only read once it is closed
+    SessionStatistics Angles;
+};
+
+// A tracker result handed from the result consumer to the render loop, with what the data window shows for it
+struct DisplayFrame {
+    BodyFrame Frame;
+    FrameDisplayInfo Info;
+    ResultStats Results;
+};
+
+// Record the time from when a frame's depth image was captured until its tracker result was popped
+void recordTrackerLatency(ResultStats& results, const BodyFrame& frame) {
+    // The system timestamp and the steady clock both come from the performance counter on Windows
+    uint64_t systemTimestamp = frame.SystemTimestampNsec;
+    uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if(systemTimestamp == 0 || systemTimestamp > now) {
         return;
     }
 
-    if(k4a_playback_get_calibration(playback_handle, &sensor_calibration) != K4A_RESULT_SUCCEEDED) {
-        std::string errorText = "Failed to get calibration";
-        printf("%s\n", errorText.c_str());
-        MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
-        return;
+    double latencyMs = (now - systemTimestamp) / 1000000.0;
+    results.LatencyCount++;
+    results.LatencySumMs += latencyMs;
+    if(latencyMs > results.LatencyMaxMs) {
+        results.LatencyMaxMs = latencyMs;
     }
+    results.LastLatencyMs = latencyMs;
+}
 
-    k4a_capture_t capture = NULL;
-    k4a_stream_result_t result = K4A_STREAM_RESULT_SUCCEEDED;
-
-    k4abt_tracker_configuration_t tracker_config = {K4ABT_SENSOR_ORIENTATION_DEFAULT};
-
-    tracker_config.processing_mode = inputSettings.CpuOnlyMode ? K4ABT_TRACKER_PROCESSING_MODE_CPU : K4ABT_TRACKER_PROCESSING_MODE_GPU;
-
-    VERIFY(k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker), "Body tracker initialization failed!");
-
-    k4abt_tracker_set_temporal_smoothing(tracker, 1);
-
-    int depthWidth = sensor_calibration.depth_camera_calibration.resolution_width;
-    int depthHeight = sensor_calibration.depth_camera_calibration.resolution_height;
-
-    window3d.Create("3D Visualization", sensor_calibration);
-    window3d.SetCloseCallback(CloseCallback);
-    window3d.SetKeyCallback(ProcessKey);
-
-    std::ofstream outputFile;
-    initOutputFile(outputFile, inputSettings.OutputFileName);
-
-    // Create application window
-    WNDCLASSEX wc = {sizeof(WNDCLASSEX), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(NULL), NULL, NULL, NULL, NULL, _T("Azure Kinect Data"), NULL};
-    ::RegisterClassEx(&wc);
-    HWND hwnd = ::CreateWindow(wc.lpszClassName, _T("Azure Kinect Data"), WS_OVERLAPPEDWINDOW, 100, 100, 480, 640, NULL, NULL, wc.hInstance, NULL);
+// Display capture counters and queue depths in the current ImGui window
+void showCaptureStats(const CaptureStats& stats, const ResultStats& results, size_t captureQueueDepth, size_t pendingQueueDepth) {
+    double averageLatencyMs = results.LatencyCount > 0 ? results.LatencySumMs / results.LatencyCount : 0.0;
+
+    ImGui::Separator();
+    ImGui::Text("Captures received: %llu", (unsigned long long) stats.CapturesReceived);
+    ImGui::Text("Captures missed by device: %llu", (unsigned long long) stats.CapturesMissed);
+    ImGui::Text("Captures dropped: %llu", (unsigned long long) stats.CapturesDropped);
+    ImGui::Text("Tracker results: %llu", (unsigned long long) results.ResultsPopped);
+    ImGui::Text("Results not shown: %llu", (unsigned long long) results.FramesNotShown);
+    ImGui::Text("Tracker latency: %.1f ms (average %.1f ms, max %.1f ms)", results.LastLatencyMs, averageLatencyMs, results.LatencyMaxMs);
+    ImGui::Text("Queue depth: %zu waiting, %zu in tracker", captureQueueDepth, pendingQueueDepth);
+}
 
-    initImGui(wc, hwnd);
+// Print the capture counters and write them to a summary file next to the output file, followed by the angle statistics of each body
+void writeCaptureSummary(CaptureStats& stats, int processedFrames, double elapsedSeconds, const std::string& outputFileName,
+                         const JointAngleTable& angleTable) {
+    std::string summaryFileName = outputFileName + ".summary.txt";
+    FILE* summaryFile = NULL;
+    if(fopen_s(&summaryFile, summaryFileName.c_str(), "w") != 0) {
+        printf("Open file %s failed.\n", summaryFileName.c_str());
+        summaryFile = NULL;
+    }
 
-    // Get main configuration and I/O between application and ImGui
-    ImGuiIO& io = ImGui::GetIO(); (void) io;
+    const ResultStats& results = stats.Results;
+    double averageLatencyMs = results.LatencyCount > 0 ? results.LatencySumMs / results.LatencyCount : 0.0;
 
-    // Our state
-    ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+    FILE* outputs[] = {stdout, summaryFile};
+    for(FILE* output : outputs) {
+        if(output == NULL) {
+            continue;
+        }
 
-    // Main loop
-    MSG msg;
-    ZeroMemory(&msg, sizeof(msg));
+        fprintf(output, "Session summary for %s\n", outputFileName.c_str());
+        fprintf(output, "  Run time: %.3f s\n", elapsedSeconds);
+        fprintf(output, "  Processed frames: %d\n", processedFrames);
+        fprintf(output, "  Captures received: %llu\n", (unsigned long long) stats.CapturesReceived);
+        fprintf(output, "  Captures missed by device: %llu\n", (unsigned long long) stats.CapturesMissed);
+        fprintf(output, "  Captures dropped before tracking: %llu\n", (unsigned long long) stats.CapturesDropped);
+        fprintf(output, "  Tracker results: %llu\n", (unsigned long long) results.ResultsPopped);
+        fprintf(output, "  Tracker latency: average %.1f ms, max %.1f ms\n", averageLatencyMs, results.LatencyMaxMs);
+        fprintf(output, "  Bodies tracked: %zu\n", stats.Angles.BodyCount());
+    }
 
-    int processedFrames = 0;
-    auto startTime = std::chrono::high_resolution_clock::now();
+    if(summaryFile != NULL) {
+        stats.Angles.Write(summaryFile, angleTable);
+        fclose(summaryFile);
+    }
+}
 
-    // Run until getting capture data fails
-    while(result == K4A_STREAM_RESULT_SUCCEEDED) {
-        bool frameProcessed = false;
+// Pipeline stage: read captures from the capture source and queue them for the tracker
+void readCaptures(CaptureSource& source, BoundedQueue<k4a_capture_t>& captureQueue, CaptureStats& stats, std::atomic<bool>& stopping) {
+    uint64_t framePeriodUsec = source.FramePeriodUsec();
+    uint64_t lastDeviceTimestamp = 0;
 
-        if(::PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE)) {
-            ::TranslateMessage(&msg);
-            ::DispatchMessage(&msg);
+    while(!stopping) {
+        k4a_capture_t capture = NULL;
+        CaptureResult result = source.NextCapture(capture, DEVICE_WAIT_MS);
+        if(result == CaptureResult::Timeout) {
             continue;
         }
+        else if(result == CaptureResult::EndOfStream) {
+            break;
+        }
+        else if(result != CaptureResult::Succeeded) {
+            std::string errorText = "Error! Get next capture failed!";
+            reportError(errorText);
+            break;
+        }
 
-        // Start the Dear ImGui frame
-        ImGui_ImplDX11_NewFrame();
-        ImGui_ImplWin32_NewFrame();
-        ImGui::NewFrame();
+        stats.CapturesReceived++;
 
-        // Make next ImGui window fill OS window
-        ImGui::SetNextWindowPos(ImVec2(0, 0));
-        ImGui::SetNextWindowSize(io.DisplaySize);
-
-        result = k4a_playback_get_next_capture(playback_handle, &capture);
-        // Check to make sure we have a depth image if we are not at the end of the file
-        if(result != K4A_STREAM_RESULT_EOF) {
-            k4a_image_t depth_image = k4a_capture_get_depth_image(capture);
-            if(depth_image == NULL) {
-                // If no depth image, print a warning and skip to next frame
-                printf("Warning: No depth image, skipping frame\n");
+        // Check to make sure we have a depth image
+        k4a_image_t depthImage = k4a_capture_get_depth_image(capture);
+        if(depthImage == NULL) {
+            // If no depth image, print a warning and pass the frame on as empty so it is still counted
+            printf("Warning: No depth image, skipping frame\n");
+            k4a_capture_release(capture);
+            capture = NULL;
+        }
+        else {
+            // Count frames the source skipped from the gap since the previous depth image
+            uint64_t deviceTimestamp = k4a_image_get_device_timestamp_usec(depthImage);
+            if(framePeriodUsec > 0 && lastDeviceTimestamp != 0 && deviceTimestamp > lastDeviceTimestamp) {
+                uint64_t framesSinceLast = (deviceTimestamp - lastDeviceTimestamp + framePeriodUsec / 2) / framePeriodUsec;
+                if(framesSinceLast > 1) {
+                    stats.CapturesMissed += framesSinceLast - 1;
+                }
+            }
+            lastDeviceTimestamp = deviceTimestamp;
+            k4a_image_release(depthImage);
+        }
+
+        if(source.IsLive()) {
+            // Drop the capture if the tracker is falling behind, so the data stays live
+            if(!captureQueue.TryPush(capture)) {
+                if(capture != NULL) {
+                    k4a_capture_release(capture);
+                }
+                stats.CapturesDropped++;
+            }
+        }
+        // Other sources wait for the tracker. Stop reading if the pipeline was stopped.
+        else if(!captureQueue.Push(capture)) {
+            if(capture != NULL) {
                 k4a_capture_release(capture);
+            }
+            break;
+        }
+    }
 
-                ++processedFrames;
+    captureQueue.Close();
+}
 
-                if (inputSettings.EmptyLines) {
-                    outputFile << processedFrames << ",," << std::endl;
-                }
+// Pipeline stage: keep the tracker input queue full and tell the result consumer whether each frame has a tracker result
+void feedTracker(BodyTracker& tracker, BoundedQueue<k4a_capture_t>& captureQueue, BoundedQueue<bool>& pendingQueue, bool live,
+                 CaptureStats& stats, std::atomic<bool>& stopping) {
+    k4a_capture_t capture = NULL;
+    while(captureQueue.Pop(capture)) {
+        bool hasDepth = capture != NULL;
+        if(hasDepth) {
+            // Live captures are dropped if the tracker has no room for them, so they do not wait behind older ones.
+            // Other sources block until the tracker has room.
+            k4a_wait_result_t queue_capture_result = tracker.EnqueueCapture(capture, live ? 0 : K4A_WAIT_INFINITE);
+
+            // Release the sensor capture once it is no longer needed.
+            k4a_capture_release(capture);
 
+            if(live && queue_capture_result == K4A_WAIT_RESULT_TIMEOUT) {
+                stats.CapturesDropped++;
                 continue;
             }
-            // Release the depth image
-            k4a_image_release(depth_image);
+            else if(queue_capture_result != K4A_WAIT_RESULT_SUCCEEDED) {
+                // The tracker is shut down when the pipeline is stopped early, which is not an error
+                if(!stopping) {
+                    std::string errorText = "Error! Add capture to tracker process queue failed!";
+                    reportError(errorText);
+                }
+                break;
+            }
         }
-        if(result == K4A_STREAM_RESULT_SUCCEEDED) {
-            // Enqueue capture and pop results - synchronous
-            k4a_wait_result_t queue_capture_result = k4abt_tracker_enqueue_capture(tracker, capture, K4A_WAIT_INFINITE);
 
-            // Release the sensor capture once it is no longer needed.
+        if(!pendingQueue.Push(hasDepth)) {
+            break;
+        }
+    }
+
+    // Release captures that were read but will not be tracked
+    captureQueue.Close();
+    while(captureQueue.Pop(capture)) {
+        if(capture != NULL) {
             k4a_capture_release(capture);
+        }
+    }
 
-            k4abt_frame_t bodyFrame = NULL;
-            k4a_wait_result_t pop_frame_result = k4abt_tracker_pop_result(tracker, &bodyFrame, K4A_WAIT_INFINITE);
-            if(pop_frame_result == K4A_WAIT_RESULT_SUCCEEDED) {
-                // Successfully got a body tracking result, process the result here
-                processFrame(bodyFrame, outputFile, processedFrames, startTime, inputSettings.EmptyLines);
+    pendingQueue.Close();
+}
 
-                VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight);
-                // Release the bodyFrame
-                k4abt_frame_release(bodyFrame);
+// Pipeline stage: pop tracker results, write their angles to the output file and post them to the render loop if there is one.
+// Runs on its own thread when windows are shown, so presenting them never holds up the tracker or the output file.
+void consumeResults(BodyTracker& tracker, BoundedQueue<bool>& pendingQueue, SkeletonOutput& outputFile, CaptureStats& stats, Mailbox<DisplayFrame*>* mailbox,
+                    DisplayFrame* frame, const InputSettings& inputSettings, std::atomic<bool>& stopping, std::atomic<bool>& finished, int& processedFrames) {
+    int64_t firstDeviceTimestamp = -1; // Device timestamp of the first processed frame
+    uint64_t lastDeviceTimestamp = 0; // Timestamps of the last frame with depth, used for frames without one
+    uint64_t lastSystemTimestamp = 0;
+    JointAngleCalculator angles(inputSettings.Angles);
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-                frameProcessed = true;
-            }
-            else {
-                std::string errorText = "Pop body frame result failed!";
-                printf("%s\n", errorText.c_str());
-                MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
+    // Run until the source runs out of captures, the pipeline is stopped or the run time is reached
+    while(true) {
+        // Wait for frames in short steps, so the run time is checked even while none arrive
+        bool hasDepth = false;
+        if(!pendingQueue.TryPop(hasDepth, std::chrono::milliseconds(RESULT_WAIT_MS))) {
+            if(pendingQueue.IsFinished()) {
                 break;
             }
         }
+        else if(!hasDepth) {
+            ++processedFrames;
 
-        // Render GUI when the 3D viewer window has updated
-        if(frameProcessed) {
-            ImGui::Render();
-            g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRenderTargetView, NULL);
-            g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, (float*) &clear_color);
-            ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-
-            g_pSwapChain->Present(1, 0); // Present with vsync
-            //g_pSwapChain->Present(0, 0); // Present without vsync
+            // A frame without depth has no timestamp of its own, so it keeps the time of the last frame with depth
+            if(inputSettings.EmptyLines) {
+                double timeSinceStart = firstDeviceTimestamp < 0 ? 0.0 : ((int64_t) lastDeviceTimestamp - firstDeviceTimestamp) / 1000000.0;
+                outputFile.Write(EmptySkeletonRecord(processedFrames, lastDeviceTimestamp, lastSystemTimestamp, timeSinceStart), NULL);
+            }
         }
+        else {
+            // The capture was already enqueued by the feeder thread, so its result is next in the tracker queue
+            k4a_wait_result_t popFrameResult = tracker.PopResult(frame->Frame, K4A_WAIT_INFINITE);
+            if(popFrameResult != K4A_WAIT_RESULT_SUCCEEDED) {
+                // The tracker is shut down when the pipeline is stopped early, which is not an error
+                if(!stopping) {
+                    std::string errorText = "Pop body frame result failed!";
+                    reportError(errorText);
+                }
+                break;
+            }
 
-        window3d.SetLayout3d(s_layoutMode);
-        window3d.SetJointFrameVisualization(s_visualizeJointFrame);
-        window3d.Render();
+            stats.Results.ResultsPopped++;
+            recordTrackerLatency(stats.Results, frame->Frame);
+            lastDeviceTimestamp = frame->Frame.DeviceTimestampUsec;
+            lastSystemTimestamp = frame->Frame.SystemTimestampNsec;
+
+            // Successfully got a body tracking result, process the result here
+            processFrame(frame->Frame, angles, outputFile, processedFrames, firstDeviceTimestamp, inputSettings.EmptyLines,
+                         mailbox != NULL ? &frame->Info : NULL);
+
+            if(mailbox != NULL) {
+                // Hand the frame to the render loop and get back the one it replaced
+                frame->Results = stats.Results;
+                if(mailbox->Post(frame)) {
+                    stats.Results.FramesNotShown++;
+                }
+            }
+            // Release the images of the processed frame, or of the frame that came back from the render loop
+            frame->Frame.Release();
+        }
 
         // Stop program if the run time has been reached
         auto curTime = std::chrono::high_resolution_clock::now();
@@ -411,57 +533,21 @@ void PlayFile(InputSettings inputSettings) {
         }
     }
 
-    k4abt_tracker_shutdown(tracker);
-    k4abt_tracker_destroy(tracker);
-    window3d.Delete();
-    printf("Finished body tracking processing!\n");
-    k4a_playback_close(playback_handle);
-    
-    outputFile.close();
-
-    // ImGui Cleanup
-    ImGui_ImplDX11_Shutdown();
-    ImGui_ImplWin32_Shutdown();
-    ImGui::DestroyContext();
-
-    CleanupDeviceD3D();
-    ::DestroyWindow(hwnd);
-    ::UnregisterClass(wc.lpszClassName, wc.hInstance);
+    finished = true;
 }
 
-// Run body tracking data collection on a real-time capture from an Azure Kinect
-void PlayFromDevice(InputSettings inputSettings) {
-    k4a_device_t device = nullptr;
-    VERIFY(k4a_device_open(0, &device), "Open K4A Device failed!");
-
-    // Start camera. Make sure depth camera is enabled.
-    k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
-    deviceConfig.depth_mode = inputSettings.DepthCameraMode;
-    deviceConfig.camera_fps = inputSettings.FrameRate;
-    deviceConfig.color_resolution = K4A_COLOR_RESOLUTION_OFF;
-
-    VERIFY(k4a_device_start_cameras(device, &deviceConfig), "Start K4A cameras failed!");
-
-    // Get calibration information
-    k4a_calibration_t sensorCalibration;
-    VERIFY(k4a_device_get_calibration(device, deviceConfig.depth_mode, deviceConfig.color_resolution, &sensorCalibration),
-           "Get depth camera calibration failed!");
-    int depthWidth = sensorCalibration.depth_camera_calibration.resolution_width;
-    int depthHeight = sensorCalibration.depth_camera_calibration.resolution_height;
-
-    // Create Body Tracker
-    k4abt_tracker_t tracker = nullptr;
-    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
-    tracker_config.processing_mode = inputSettings.CpuOnlyMode ? K4ABT_TRACKER_PROCESSING_MODE_CPU : K4ABT_TRACKER_PROCESSING_MODE_GPU;
-    VERIFY(k4abt_tracker_create(&sensorCalibration, tracker_config, &tracker), "Body tracker initialization failed!");
+// Create the 3D viewer and data window, show the latest processed frame until the session ends or the windows are closed,
+// then destroy them. Only called when windows are shown.
+void renderWindows(const k4a_calibration_t& sensorCalibration, const InputSettings& inputSettings, Mailbox<DisplayFrame*>& mailbox,
+                   DisplayFrame*& shownFrame, const CaptureStats& stats, BoundedQueue<k4a_capture_t>& captureQueue,
+                   BoundedQueue<bool>& pendingQueue, const std::atomic<bool>& consumerFinished) {
     // Initialize the 3d window controller
     Window3dWrapper window3d;
     window3d.Create("3D Visualization", sensorCalibration);
     window3d.SetCloseCallback(CloseCallback);
     window3d.SetKeyCallback(ProcessKey);
-
-    std::ofstream outputFile;
-    initOutputFile(outputFile, inputSettings.OutputFileName);
+    window3d.SetGpuUnprojection(!inputSettings.CpuPointCloud);
+    window3d.SetPointCloudDecimation(inputSettings.PointCloudMode, inputSettings.PointCloudStride, inputSettings.VoxelSize / 1000.0f);
 
     // Create application window
     WNDCLASSEX wc = {sizeof(WNDCLASSEX), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(NULL), NULL, NULL, NULL, NULL, _T("Azure Kinect Data"), NULL};
@@ -470,9 +556,6 @@ void PlayFromDevice(InputSettings inputSettings) {
 
     initImGui(wc, hwnd);
 
-    // Get main configuration and I/O between application and ImGui
-    ImGuiIO& io = ImGui::GetIO(); (void) io;
-
     // Our state
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
@@ -480,19 +563,42 @@ void PlayFromDevice(InputSettings inputSettings) {
     MSG msg;
     ZeroMemory(&msg, sizeof(msg));
 
-    int processedFrames = 0;
-    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<Color> bodyIndexColors; // Point cloud palette reused for every frame
 
-    // Run until the program is closed
-    while(s_isRunning) {
-        bool frameProcessed = false;
+    // Render at the target rate, or as often as the windows can be presented if it is 0
+    auto renderPeriod = std::chrono::microseconds(inputSettings.RenderRate > 0 ? 1000000 / inputSettings.RenderRate : 0);
+    auto nextRenderTime = std::chrono::steady_clock::now();
 
+    // Run until the source runs out of captures, the run time is reached or the program is closed
+    while(s_isRunning && !consumerFinished) {
         if(::PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE)) {
             ::TranslateMessage(&msg);
             ::DispatchMessage(&msg);
             continue;
         }
 
+        // Wait for the next render, waking up early to handle window messages
+        auto now = std::chrono::steady_clock::now();
+        if(now < nextRenderTime) {
+            DWORD waitMs = (DWORD) std::chrono::duration_cast<std::chrono::milliseconds>(nextRenderTime - now).count();
+            ::MsgWaitForMultipleObjects(0, NULL, FALSE, waitMs, QS_ALLINPUT);
+            continue;
+        }
+
+        // Count from now if rendering fell behind, instead of rendering several frames in a row to catch up
+        nextRenderTime += renderPeriod;
+        if(nextRenderTime < now) {
+            nextRenderTime = now + renderPeriod;
+        }
+
+        // Show the latest processed frame if there is a new one
+        if(mailbox.Take(shownFrame)) {
+            VisualizeResult(shownFrame->Frame, window3d, bodyIndexColors);
+
+            // The 3D window holds its own references to the images until it renders them, so the frame can be released
+            shownFrame->Frame.Release();
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplDX11_NewFrame();
         ImGui_ImplWin32_NewFrame();
@@ -500,81 +606,28 @@ void PlayFromDevice(InputSettings inputSettings) {
 
         // Make next ImGui window fill OS window
         ImGui::SetNextWindowPos(ImVec2(0, 0));
-        ImGui::SetNextWindowSize(io.DisplaySize);
-        
-        k4a_capture_t sensorCapture = nullptr;
-        k4a_wait_result_t getCaptureResult = k4a_device_get_capture(device, &sensorCapture, 0); // timeout_in_ms is set to 0
+        ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
 
-        if(getCaptureResult == K4A_WAIT_RESULT_SUCCEEDED) {
-            // timeout_in_ms is set to 0. Return immediately no matter whether the sensorCapture is successfully added
-            // to the queue or not.
-            k4a_wait_result_t queueCaptureResult = k4abt_tracker_enqueue_capture(tracker, sensorCapture, 0);
+        ImGui::Begin("Data", (bool*) 0, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
+        showFrameInfo(shownFrame->Info, inputSettings.Angles);
+        showCaptureStats(stats, shownFrame->Results, captureQueue.Size(), pendingQueue.Size());
+        ImGui::End();
 
-            // Release the sensor capture once it is no longer needed.
-            k4a_capture_release(sensorCapture);
-
-            if(queueCaptureResult == K4A_WAIT_RESULT_FAILED) {
-                std::string errorText = "Error! Add capture to tracker process queue failed!";
-                printf("%s\n", errorText.c_str());
-                MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
-                break;
-            }
-        }
-        else if(getCaptureResult != K4A_WAIT_RESULT_TIMEOUT) {
-            std::string errorText = "Get depth capture returned error: " + std::to_string(getCaptureResult);
-            printf("%s\n", errorText.c_str());
-            MessageBoxA(0, errorText.c_str(), NULL, MB_OK | MB_ICONHAND);
-            break;
-        }
+        ImGui::Render();
+        g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRenderTargetView, NULL);
+        g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, (float*) &clear_color);
+        ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 
-        // Pop Result from Body Tracker
-        k4abt_frame_t bodyFrame = nullptr;
-        k4a_wait_result_t popFrameResult = k4abt_tracker_pop_result(tracker, &bodyFrame, 0); // timeout_in_ms is set to 0
-        if(popFrameResult == K4A_WAIT_RESULT_SUCCEEDED) {
-            // Successfully got a body tracking result, process the result here
-            processFrame(bodyFrame, outputFile, processedFrames, startTime, inputSettings.EmptyLines);
-
-            VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight);
-            // Release the bodyFrame
-            k4abt_frame_release(bodyFrame);
-
-            frameProcessed = true;
-        }
-
-        // Render GUI when the 3D viewer window has updated
-        if(frameProcessed) {
-            ImGui::Render();
-            g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRenderTargetView, NULL);
-            g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, (float*) &clear_color);
-            ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-
-            g_pSwapChain->Present(1, 0); // Present with vsync
-            //g_pSwapChain->Present(0, 0); // Present without vsync
-        }
+        //g_pSwapChain->Present(1, 0); // Present with vsync
+        g_pSwapChain->Present(0, 0); // Present without vsync, the render rate paces the loop
 
         window3d.SetLayout3d(s_layoutMode);
         window3d.SetJointFrameVisualization(s_visualizeJointFrame);
         window3d.Render();
-
-        // Stop program if the run time has been reached
-        auto curTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(curTime - startTime);
-        if(inputSettings.RunTime >= 0 && duration.count() >= inputSettings.RunTime) {
-            s_isRunning = false;
-        }
     }
 
-    printf("Finished body tracking processing!\n");
-
     window3d.Delete();
-    k4abt_tracker_shutdown(tracker);
-    k4abt_tracker_destroy(tracker);
-
-    k4a_device_stop_cameras(device);
-    k4a_device_close(device);
 
-    outputFile.close();
-    
     // ImGui Cleanup
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
@@ -583,4 +636,141 @@ void PlayFromDevice(InputSettings inputSettings) {
     CleanupDeviceD3D();
     ::DestroyWindow(hwnd);
     ::UnregisterClass(wc.lpszClassName, wc.hInstance);
+}
+
+// Run body tracking data collection on the captures of the passed source and return the number of processed frames,
+// or -1 if the output file could not be opened
+int runSession(CaptureSource& source, BodyTracker& tracker, InputSettings& inputSettings) {
+    const k4a_calibration_t& sensorCalibration = source.Calibration();
+    // The binary output format stores the calibration the captures were made with
+    CaptureStats stats;
+    stats.Angles.Reset(inputSettings.Angles.Count());
+    SkeletonOutput outputFile;
+    if(!initOutputFile(outputFile, inputSettings, sensorCalibration, source.RawCalibration(), &stats.Angles)) {
+        return -1;
+    }
+
+    // Start the pipeline stages. Reading captures, feeding the tracker and consuming its results run on their own threads,
+    // so this thread only updates the windows. Without windows, results are consumed on this thread and no window,
+    // message box or graphics device is ever created.
+    BoundedQueue<k4a_capture_t> captureQueue(CAPTURE_QUEUE_SIZE);
+    BoundedQueue<bool> pendingQueue(PENDING_QUEUE_SIZE);
+    std::atomic<bool> stopping(false);
+    std::atomic<bool> consumerFinished(false);
+    int processedFrames = 0;
+
+    // The consumer, the mailbox and the render loop each own one of the frames. The mailbox only holds the latest result,
+    // so the render loop skips results it is too slow for instead of holding up the consumer.
+    DisplayFrame displayFrames[3];
+    Mailbox<DisplayFrame*> mailbox(&displayFrames[1]);
+    DisplayFrame* shownFrame = &displayFrames[2];
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::thread readerThread(readCaptures, std::ref(source), std::ref(captureQueue), std::ref(stats), std::ref(stopping));
+    std::thread feederThread(feedTracker, std::ref(tracker), std::ref(captureQueue), std::ref(pendingQueue), source.IsLive(), std::ref(stats),
+                             std::ref(stopping));
+    std::thread consumerThread;
+
+    if(s_headless) {
+        consumeResults(tracker, pendingQueue, outputFile, stats, NULL, &displayFrames[0], inputSettings, stopping, consumerFinished, processedFrames);
+    }
+    else {
+        consumerThread = std::thread(consumeResults, std::ref(tracker), std::ref(pendingQueue), std::ref(outputFile), std::ref(stats), &mailbox,
+                                     &displayFrames[0], std::cref(inputSettings), std::ref(stopping), std::ref(consumerFinished), std::ref(processedFrames));
+        renderWindows(sensorCalibration, inputSettings, mailbox, shownFrame, stats, captureQueue, pendingQueue, consumerFinished);
+    }
+
+    // Stop the pipeline. A live reader notices within one capture wait, and shutting down the tracker
+    // unblocks the feeder if it is waiting on a full tracker queue.
+    stopping = true;
+    captureQueue.Close();
+    pendingQueue.Close();
+    tracker.Shutdown();
+    readerThread.join();
+    feederThread.join();
+    if(consumerThread.joinable()) {
+        consumerThread.join();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(endTime - startTime).count();
+    printf("Finished body tracking processing!\n");
+    printf("Processed %d frames in %.3f s (%.1f frames/s).\n", processedFrames, elapsedSeconds,
+           elapsedSeconds > 0 ? processedFrames / elapsedSeconds : 0.0);
+
+    // Write every row that is still buffered or waiting for the filter, so the statistics cover the whole file
+    outputFile.Close();
+    writeCaptureSummary(stats, processedFrames, elapsedSeconds, inputSettings.OutputFileName, inputSettings.Angles);
+
+    return processedFrames;
+}
+
+// Run body tracking data collection on a pre-recorded video file and return the number of processed frames, or -1 on error
+int PlayFile(InputSettings inputSettings) {
+    s_headless = inputSettings.Headless;
+
+    // Attempt to open pre-recorded video file
+    PlaybackCaptureSource source;
+    std::string errorText;
+    if(!source.Open(inputSettings.InputFileName, errorText)) {
+        reportError(errorText);
+        return -1;
+    }
+
+    k4abt_tracker_configuration_t tracker_config = {K4ABT_SENSOR_ORIENTATION_DEFAULT};
+
+    tracker_config.processing_mode = inputSettings.CpuOnlyMode ? K4ABT_TRACKER_PROCESSING_MODE_CPU : K4ABT_TRACKER_PROCESSING_MODE_GPU;
+
+    K4abtBodyTracker tracker;
+    if(tracker.Create(source.Calibration(), tracker_config) != K4A_RESULT_SUCCEEDED) {
+        errorText = "Body tracker initialization failed!";
+        reportError(errorText);
+        return -1;
+    }
+
+    // Recordings have always been tracked with full smoothing unless asked otherwise
+    tracker.SetTemporalSmoothing(inputSettings.TrackerSmoothing >= 0.0f ? inputSettings.TrackerSmoothing : 1.0f);
+
+    return runSession(source, tracker, inputSettings);
+}
+
+// Run body tracking data collection on a real-time capture from an Azure Kinect and return the number of processed frames, or -1 on error
+int PlayFromDevice(InputSettings inputSettings) {
+    s_headless = inputSettings.Headless;
+
+    DeviceCaptureSource source;
+    std::string errorText;
+    if(!source.Open(inputSettings.DepthCameraMode, inputSettings.FrameRate, errorText)) {
+        reportError(errorText);
+        return -1;
+    }
+
+    // Create Body Tracker
+    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
+    tracker_config.processing_mode = inputSettings.CpuOnlyMode ? K4ABT_TRACKER_PROCESSING_MODE_CPU : K4ABT_TRACKER_PROCESSING_MODE_GPU;
+    K4abtBodyTracker tracker;
+    if(tracker.Create(source.Calibration(), tracker_config) != K4A_RESULT_SUCCEEDED) {
+        errorText = "Body tracker initialization failed!";
+        reportError(errorText);
+        return -1;
+    }
+
+    // Keep the body tracking SDK default unless asked otherwise
+    if(inputSettings.TrackerSmoothing >= 0.0f) {
+        tracker.SetTemporalSmoothing(inputSettings.TrackerSmoothing);
+    }
+
+    return runSession(source, tracker, inputSettings);
+}
+
+// Run data collection on generated depth frames and scripted skeletons, without a device or the body tracking SDK,
+// and return the number of processed frames, or -1 on error
+int PlaySynthetic(InputSettings inputSettings) {
+    s_headless = inputSettings.Headless;
+
+    SyntheticCaptureSource source(inputSettings.DepthCameraMode, inputSettings.SyntheticBodies,
+                                  inputSettings.SyntheticFrameRate, inputSettings.SyntheticFrames);
+    ScriptedBodyTracker tracker(source.Calibration(), source.BodyCount());
+
+    return runSession(source, tracker, inputSettings);
 }
\ No newline at end of file
@@ -10,9 +10,20 @@
  */
 
 #include <string>
+#include <vector>
 
 #include <k4abt.h>
 
+#include <WindowController3dTypes.h>
+
+#include "JointAngles.h"
+#include "JointFilters.h"
+
+struct SkeletonCsvOptions;
+
+// Extension of the file each batch job reports its frame count in, added to its output file name
+const char BATCH_FRAME_COUNT_EXTENSION[] = ".frames";
+
 // Store option values for the program
 struct InputSettings {
     k4a_depth_mode_t DepthCameraMode = K4A_DEPTH_MODE_NFOV_UNBINNED;
@@ -20,9 +31,40 @@ struct InputSettings {
     bool CpuOnlyMode = false;
     bool Offline = false;
     bool EmptyLines = false;
+    bool Headless = false;
+    bool Batch = false;
+    bool BinaryOutput = false;
+    bool Timestamps = false;
+    bool Kinematics = false; // Add joint and angle velocity and acceleration columns to CSV output
+    bool RawOutput = false; // Add unfiltered angle and joint columns to CSV output when a filter is used
+    bool ExportCsv = false;
+    bool Synthetic = false;
+    bool Benchmark = false;
+    bool CpuPointCloud = false; // Build point cloud vertices on the CPU instead of unprojecting the depth frame on the GPU
+    int BatchJobs = 1;
     int RunTime = -1;
-    std::string InputFileName;
-    std::string OutputFileName;
+    int SyntheticBodies = 2;
+    int SyntheticFrameRate = 30;
+    Visualization::PointCloudDecimation PointCloudMode = Visualization::PointCloudDecimation::Full; // Points drawn by the 3D viewer
+    int PointCloudStride = 2; // Pixel stride of the STRIDE point cloud mode
+    int VoxelSize = 20; // Voxel size of the VOXEL point cloud mode in millimeters
+    int RenderRate = 30; // Target frame rate of the 3D viewer and data window, or 0 to render as often as they can be presented
+    JointFilterType Filter = JointFilterType::None; // Filter of joint positions before angles are calculated for the output
+    float Smoothing = 0.5f; // Smoothing factor of the filter, from 0 to 1
+    int FilterLookahead = 2; // Future frames used by the Savitzky-Golay filter
+    float TrackerSmoothing = -1.0f; // Temporal smoothing of the body tracker from 0 to 1, or below 0 for the default of each mode
+    uint32_t SyntheticFrames = 900; // Generate frames until closed if 0
+    uint32_t ExportFirstFrame = 0;
+    uint32_t ExportLastFrame = UINT32_MAX;
+    uint32_t ExportBodyId = K4ABT_INVALID_BODY_ID; // Export every body
+    std::string InputFileName; // Binary skeleton file in export mode
+    std::string OutputFileName; // Output directory in batch mode
+    std::string BatchInput;
+    std::vector<std::string> BatchArguments; // Options passed on to the process of each recording in batch mode
+    std::string AnglesFileName; // Angle config file, or the default angles if empty
+    std::string FrameCountFileName; // File the number of processed frames is written to, used by batch mode to collect its jobs' counts
+    std::string CompareFileName; // Expected CSV output the session is compared with, or no comparison if empty
+    JointAngleTable Angles; // Angles written to the output, loaded from AnglesFileName
 };
 
 // Print command-line argument usage to the command line
@@ -33,7 +75,23 @@ void PrintAppUsage();
 bool runStartupGUI(InputSettings& is);
 // Set input settings from command-line arguments
 bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettings);
-// Run body tracking data collection on a pre-recorded video file
-void PlayFile(InputSettings inputSettings);
-// Run body tracking data collection on a real-time capture from an Azure Kinect
-void PlayFromDevice(InputSettings inputSettings);
\ No newline at end of file
+// CSV columns and joint filter of the output, from the input settings
+SkeletonCsvOptions GetSkeletonCsvOptions(const InputSettings& inputSettings);
+// Check if a file exists with the passed filename
+bool fileExists(std::string filename);
+// Run body tracking data collection on a pre-recorded video file and return the number of processed frames, or -1 on error
+int PlayFile(InputSettings inputSettings);
+// Time the point cloud vertex builders and joint angle calculator on generated data and check that they match the previous code
+bool RunBenchmark();
+// Compare a CSV output with an expected one, with numbers allowed to differ slightly, and print the first differences
+bool CompareCsvFiles(const std::string& fileName, const std::string& expectedFileName);
+// Run body tracking data collection on every recording in a batch, each in its own headless process,
+// and return the number of recordings that failed, or -1 if the batch could not be started
+int RunBatch(InputSettings inputSettings);
+// Write the number of processed frames of a session to a file as a single number, for the batch that started it
+bool WriteFrameCountFile(const std::string& fileName, int processedFrames);
+// Run body tracking data collection on a real-time capture from an Azure Kinect and return the number of processed frames, or -1 on error
+int PlayFromDevice(InputSettings inputSettings);
+// Run data collection on generated depth frames and scripted skeletons, without a device or the body tracking SDK,
+// and return the number of processed frames, or -1 on error
+int PlaySynthetic(InputSettings inputSettings);
\ No newline at end of file
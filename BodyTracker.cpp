@@ -0,0 +1,76 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * BodyTracker.cpp
+ * Contains the body tracker that runs the Azure Kinect Body Tracking SDK.
+ */
+
+#include "BodyTracker.h"
+
+void BodyFrame::Release() {
+    if(DepthImage != NULL) {
+        k4a_image_release(DepthImage);
+        DepthImage = NULL;
+    }
+
+    if(BodyIndexMap != NULL) {
+        k4a_image_release(BodyIndexMap);
+        BodyIndexMap = NULL;
+    }
+
+    Bodies.clear();
+    DeviceTimestampUsec = 0;
+    SystemTimestampNsec = 0;
+}
+
+K4abtBodyTracker::~K4abtBodyTracker() {
+    if(m_tracker != NULL) {
+        k4abt_tracker_destroy(m_tracker);
+    }
+}
+
+k4a_result_t K4abtBodyTracker::Create(const k4a_calibration_t& calibration, k4abt_tracker_configuration_t config) {
+    return k4abt_tracker_create(&calibration, config, &m_tracker);
+}
+
+void K4abtBodyTracker::SetTemporalSmoothing(float smoothingFactor) {
+    k4abt_tracker_set_temporal_smoothing(m_tracker, smoothingFactor);
+}
+
+k4a_wait_result_t K4abtBodyTracker::EnqueueCapture(k4a_capture_t capture, int32_t timeoutMs) {
+    return k4abt_tracker_enqueue_capture(m_tracker, capture, timeoutMs);
+}
+
+k4a_wait_result_t K4abtBodyTracker::PopResult(BodyFrame& frame, int32_t timeoutMs) {
+    frame.Release();
+
+    k4abt_frame_t bodyFrame = NULL;
+    k4a_wait_result_t result = k4abt_tracker_pop_result(m_tracker, &bodyFrame, timeoutMs);
+    if(result != K4A_WAIT_RESULT_SUCCEEDED) {
+        return result;
+    }
+
+    frame.DeviceTimestampUsec = k4abt_frame_get_device_timestamp_usec(bodyFrame);
+    frame.SystemTimestampNsec = k4abt_frame_get_system_timestamp_nsec(bodyFrame);
+
+    uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
+    frame.Bodies.resize(numBodies);
+    for(uint32_t i = 0; i < numBodies; i++) {
+        frame.Bodies[i].id = k4abt_frame_get_body_id(bodyFrame, i);
+        k4abt_frame_get_body_skeleton(bodyFrame, i, &frame.Bodies[i].skeleton);
+    }
+
+    // Keep the images used for visualization after the body frame is released
+    k4a_capture_t originalCapture = k4abt_frame_get_capture(bodyFrame);
+    frame.DepthImage = k4a_capture_get_depth_image(originalCapture);
+    k4a_capture_release(originalCapture);
+    frame.BodyIndexMap = k4abt_frame_get_body_index_map(bodyFrame);
+
+    k4abt_frame_release(bodyFrame);
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+void K4abtBodyTracker::Shutdown() {
+    k4abt_tracker_shutdown(m_tracker);
+}
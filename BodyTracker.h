@@ -0,0 +1,65 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * BodyTracker.h
+ * Contains the body tracker interface used by data collection and its
+ * implementation with the Azure Kinect Body Tracking SDK.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <k4abt.h>
+
+// Body tracking result for one capture
+struct BodyFrame {
+    uint64_t DeviceTimestampUsec = 0;
+    uint64_t SystemTimestampNsec = 0;
+    std::vector<k4abt_body_t> Bodies; // Values in the body index map are indices into this list
+    k4a_image_t DepthImage = NULL;
+    k4a_image_t BodyIndexMap = NULL;
+
+    BodyFrame() = default;
+    ~BodyFrame() { Release(); }
+
+    BodyFrame(const BodyFrame&) = delete;
+    BodyFrame& operator=(const BodyFrame&) = delete;
+
+    // Release the images and clear the bodies, keeping the memory of the body list for the next result
+    void Release();
+};
+
+class BodyTracker {
+public:
+    virtual ~BodyTracker() = default;
+
+    // Add a capture to the tracker input queue, waiting up to the passed timeout while it is full.
+    // The tracker takes its own reference to the capture.
+    virtual k4a_wait_result_t EnqueueCapture(k4a_capture_t capture, int32_t timeoutMs) = 0;
+    // Get the result for the oldest enqueued capture, waiting up to the passed timeout
+    virtual k4a_wait_result_t PopResult(BodyFrame& frame, int32_t timeoutMs) = 0;
+    // Make waiting calls return and stop accepting captures
+    virtual void Shutdown() = 0;
+};
+
+// Body tracker that runs the Azure Kinect Body Tracking SDK
+class K4abtBodyTracker : public BodyTracker {
+public:
+    K4abtBodyTracker() = default;
+    ~K4abtBodyTracker();
+
+    K4abtBodyTracker(const K4abtBodyTracker&) = delete;
+    K4abtBodyTracker& operator=(const K4abtBodyTracker&) = delete;
+
+    k4a_result_t Create(const k4a_calibration_t& calibration, k4abt_tracker_configuration_t config);
+    void SetTemporalSmoothing(float smoothingFactor);
+
+    k4a_wait_result_t EnqueueCapture(k4a_capture_t capture, int32_t timeoutMs) override;
+    k4a_wait_result_t PopResult(BodyFrame& frame, int32_t timeoutMs) override;
+    void Shutdown() override;
+
+private:
+    k4abt_tracker_t m_tracker = NULL;
+};
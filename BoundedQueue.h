@@ -0,0 +1,111 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * BoundedQueue.h
+ * Contains a fixed-capacity thread-safe queue used to connect the stages
+ * of the data collection pipeline.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Add an item, waiting while the queue is full. Returns false if the queue was closed,
+    // in which case the caller still owns the item.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if(m_closed) {
+            return false;
+        }
+
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Add an item only if there is room for it right now. Returns false if the queue was full or closed,
+    // in which case the caller still owns the item.
+    bool TryPush(T item) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_closed || m_items.size() >= m_capacity) {
+            return false;
+        }
+
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Remove the oldest item, waiting while the queue is empty. Returns false once the queue
+    // has been closed and every remaining item has been removed.
+    bool Pop(T& item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        return popLocked(item);
+    }
+
+    // Same as Pop, but gives up after the passed timeout. Use IsFinished to tell a timeout
+    // apart from a closed and empty queue.
+    bool TryPop(T& item, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait_for(lock, timeout, [this] { return m_closed || !m_items.empty(); });
+        return popLocked(item);
+    }
+
+    // Stop accepting items and wake every waiting thread. Items already in the queue can still be popped.
+    void Close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    // Accept items again after Close, so the queue can be reused once every thread using it has stopped
+    void Reopen() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = false;
+    }
+
+    // Check if the queue is closed and has no items left
+    bool IsFinished() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed && m_items.empty();
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+private:
+    bool popLocked(T& item) {
+        if(m_items.empty()) {
+            return false;
+        }
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    const size_t m_capacity;
+    bool m_closed = false;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
@@ -0,0 +1,128 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * CaptureSource.cpp
+ * Contains the device and pre-recorded video file capture sources.
+ */
+
+#include "CaptureSource.h"
+
+uint64_t GetFramePeriodUsec(k4a_fps_t frameRate) {
+    switch(frameRate) {
+        case K4A_FRAMES_PER_SECOND_5:
+            return 200000;
+        case K4A_FRAMES_PER_SECOND_15:
+            return 66667;
+        default:
+            return 33333;
+    }
+}
+
+DeviceCaptureSource::~DeviceCaptureSource() {
+    if(m_camerasStarted) {
+        k4a_device_stop_cameras(m_device);
+    }
+
+    if(m_device != NULL) {
+        k4a_device_close(m_device);
+    }
+}
+
+bool DeviceCaptureSource::Open(k4a_depth_mode_t depthMode, k4a_fps_t frameRate, std::string& errorText) {
+    if(k4a_device_open(0, &m_device) != K4A_RESULT_SUCCEEDED) {
+        m_device = NULL;
+        errorText = "Open K4A Device failed!";
+        return false;
+    }
+
+    // Start camera. Make sure depth camera is enabled.
+    k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+    deviceConfig.depth_mode = depthMode;
+    deviceConfig.camera_fps = frameRate;
+    deviceConfig.color_resolution = K4A_COLOR_RESOLUTION_OFF;
+
+    if(k4a_device_start_cameras(m_device, &deviceConfig) != K4A_RESULT_SUCCEEDED) {
+        errorText = "Start K4A cameras failed!";
+        return false;
+    }
+    m_camerasStarted = true;
+    m_framePeriodUsec = GetFramePeriodUsec(frameRate);
+
+    // Get calibration information
+    if(k4a_device_get_calibration(m_device, deviceConfig.depth_mode, deviceConfig.color_resolution, &m_calibration) != K4A_RESULT_SUCCEEDED) {
+        errorText = "Get depth camera calibration failed!";
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> DeviceCaptureSource::RawCalibration() const {
+    std::vector<uint8_t> rawCalibration;
+    size_t rawCalibrationSize = 0;
+    if(k4a_device_get_raw_calibration(m_device, NULL, &rawCalibrationSize) == K4A_BUFFER_RESULT_TOO_SMALL) {
+        rawCalibration.resize(rawCalibrationSize);
+        k4a_device_get_raw_calibration(m_device, rawCalibration.data(), &rawCalibrationSize);
+    }
+    return rawCalibration;
+}
+
+CaptureResult DeviceCaptureSource::NextCapture(k4a_capture_t& capture, int32_t timeoutMs) {
+    switch(k4a_device_get_capture(m_device, &capture, timeoutMs)) {
+        case K4A_WAIT_RESULT_SUCCEEDED:
+            return CaptureResult::Succeeded;
+        case K4A_WAIT_RESULT_TIMEOUT:
+            return CaptureResult::Timeout;
+        default:
+            return CaptureResult::Failed;
+    }
+}
+
+PlaybackCaptureSource::~PlaybackCaptureSource() {
+    if(m_playback != NULL) {
+        k4a_playback_close(m_playback);
+    }
+}
+
+bool PlaybackCaptureSource::Open(const std::string& fileName, std::string& errorText) {
+    if(k4a_playback_open(fileName.c_str(), &m_playback) != K4A_RESULT_SUCCEEDED) {
+        m_playback = NULL;
+        errorText = "Failed to open recording: " + fileName;
+        return false;
+    }
+
+    if(k4a_playback_get_calibration(m_playback, &m_calibration) != K4A_RESULT_SUCCEEDED) {
+        errorText = "Failed to get calibration";
+        return false;
+    }
+
+    k4a_record_configuration_t recordConfig;
+    if(k4a_playback_get_record_configuration(m_playback, &recordConfig) == K4A_RESULT_SUCCEEDED) {
+        m_framePeriodUsec = GetFramePeriodUsec(recordConfig.camera_fps);
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> PlaybackCaptureSource::RawCalibration() const {
+    std::vector<uint8_t> rawCalibration;
+    size_t rawCalibrationSize = 0;
+    if(k4a_playback_get_raw_calibration(m_playback, NULL, &rawCalibrationSize) == K4A_BUFFER_RESULT_TOO_SMALL) {
+        rawCalibration.resize(rawCalibrationSize);
+        k4a_playback_get_raw_calibration(m_playback, rawCalibration.data(), &rawCalibrationSize);
+    }
+    return rawCalibration;
+}
+
+// Reading from a file never has to wait, so the timeout is not used
+CaptureResult PlaybackCaptureSource::NextCapture(k4a_capture_t& capture, int32_t /*timeoutMs*/) {
+    switch(k4a_playback_get_next_capture(m_playback, &capture)) {
+        case K4A_STREAM_RESULT_SUCCEEDED:
+            return CaptureResult::Succeeded;
+        case K4A_STREAM_RESULT_EOF:
+            return CaptureResult::EndOfStream;
+        default:
+            return CaptureResult::Failed;
+    }
+}
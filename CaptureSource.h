@@ -0,0 +1,92 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * CaptureSource.h
+ * Contains the capture source interface used by data collection and its
+ * implementations for an Azure Kinect device and pre-recorded video files.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <k4a/k4a.h>
+#include <k4arecord/playback.h>
+
+// Result of waiting for the next capture from a capture source
+enum class CaptureResult {
+    Succeeded,
+    Timeout,
+    EndOfStream,
+    Failed
+};
+
+class CaptureSource {
+public:
+    virtual ~CaptureSource() = default;
+
+    // Calibration of the depth camera the captures come from
+    virtual const k4a_calibration_t& Calibration() const = 0;
+    // Raw calibration JSON stored in binary output files. Empty if the source has none.
+    virtual std::vector<uint8_t> RawCalibration() const = 0;
+    // Live sources keep producing captures whether or not they are processed, so captures are dropped
+    // when processing falls behind. Other sources wait for processing to catch up.
+    virtual bool IsLive() const = 0;
+    // Expected time between captures, used to count captures the source skipped
+    virtual uint64_t FramePeriodUsec() const = 0;
+    // Wait up to the passed timeout for the next capture
+    virtual CaptureResult NextCapture(k4a_capture_t& capture, int32_t timeoutMs) = 0;
+};
+
+// Get the time between frames at the passed frame rate in microseconds
+uint64_t GetFramePeriodUsec(k4a_fps_t frameRate);
+
+// Captures from an Azure Kinect device
+class DeviceCaptureSource : public CaptureSource {
+public:
+    DeviceCaptureSource() = default;
+    ~DeviceCaptureSource();
+
+    DeviceCaptureSource(const DeviceCaptureSource&) = delete;
+    DeviceCaptureSource& operator=(const DeviceCaptureSource&) = delete;
+
+    // Open the first device and start its depth camera
+    bool Open(k4a_depth_mode_t depthMode, k4a_fps_t frameRate, std::string& errorText);
+
+    const k4a_calibration_t& Calibration() const override { return m_calibration; }
+    std::vector<uint8_t> RawCalibration() const override;
+    bool IsLive() const override { return true; }
+    uint64_t FramePeriodUsec() const override { return m_framePeriodUsec; }
+    CaptureResult NextCapture(k4a_capture_t& capture, int32_t timeoutMs) override;
+
+private:
+    k4a_device_t m_device = NULL;
+    bool m_camerasStarted = false;
+    uint64_t m_framePeriodUsec = 0;
+    k4a_calibration_t m_calibration = {};
+};
+
+// Captures from a pre-recorded video file
+class PlaybackCaptureSource : public CaptureSource {
+public:
+    PlaybackCaptureSource() = default;
+    ~PlaybackCaptureSource();
+
+    PlaybackCaptureSource(const PlaybackCaptureSource&) = delete;
+    PlaybackCaptureSource& operator=(const PlaybackCaptureSource&) = delete;
+
+    bool Open(const std::string& fileName, std::string& errorText);
+
+    const k4a_calibration_t& Calibration() const override { return m_calibration; }
+    std::vector<uint8_t> RawCalibration() const override;
+    bool IsLive() const override { return false; }
+    uint64_t FramePeriodUsec() const override { return m_framePeriodUsec; }
+    CaptureResult NextCapture(k4a_capture_t& capture, int32_t timeoutMs) override;
+
+private:
+    k4a_playback_t m_playback = NULL;
+    uint64_t m_framePeriodUsec = 0;
+    k4a_calibration_t m_calibration = {};
+};
@@ -0,0 +1,165 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * CsvWriter.cpp
+ * Contains the buffered output file writer.
+ */
+
+#include <charconv>
+#include <cstring>
+
+#include "CsvWriter.h"
+
+// Number of filled buffers that can wait for the disk before formatting has to wait too
+const size_t FULL_BUFFER_COUNT = 4;
+// Room for the row that pushes a buffer past its flush size
+const size_t ROW_MARGIN = 4096;
+
+CsvWriter::CsvWriter(size_t flushBytes, int flushIntervalMs)
+    : m_flushBytes(flushBytes)
+    , m_flushInterval(flushIntervalMs)
+    , m_fullBuffers(FULL_BUFFER_COUNT)
+    , m_freeBuffers(FULL_BUFFER_COUNT + 2) {
+}
+
+CsvWriter::~CsvWriter() {
+    Close();
+}
+
+bool CsvWriter::Open(const std::string& fileName) {
+    Close();
+
+    // Text mode keeps the same line endings as the earlier std::ofstream output
+    if(fopen_s(&m_file, fileName.c_str(), "w") != 0) {
+        m_file = NULL;
+        return false;
+    }
+
+    // Buffers are already large, so skip the C runtime buffer and its extra copy
+    setvbuf(m_file, NULL, _IONBF, 0);
+
+    m_writeFailed = false;
+    m_buffer.clear();
+    m_buffer.reserve(m_flushBytes + ROW_MARGIN);
+    m_lastFlush = std::chrono::steady_clock::now();
+
+    // Close stopped the background thread of the previous file by closing its queue
+    m_fullBuffers.Reopen();
+    m_writerThread = std::thread(&CsvWriter::writeBuffers, this);
+
+    return true;
+}
+
+void CsvWriter::Close() {
+    if(m_file == NULL) {
+        return;
+    }
+
+    Flush();
+    m_fullBuffers.Close();
+    m_writerThread.join();
+
+    fclose(m_file);
+    m_file = NULL;
+}
+
+CsvWriter& CsvWriter::operator<<(const char* text) {
+    m_buffer.append(text);
+    return *this;
+}
+
+CsvWriter& CsvWriter::operator<<(const std::string& text) {
+    m_buffer.append(text);
+    return *this;
+}
+
+CsvWriter& CsvWriter::operator<<(char c) {
+    m_buffer.push_back(c);
+    return *this;
+}
+
+CsvWriter& CsvWriter::operator<<(int value) {
+    return appendInteger(value);
+}
+
+CsvWriter& CsvWriter::operator<<(unsigned int value) {
+    return appendInteger(value);
+}
+
+CsvWriter& CsvWriter::operator<<(long long value) {
+    return appendInteger(value);
+}
+
+CsvWriter& CsvWriter::operator<<(unsigned long long value) {
+    return appendInteger(value);
+}
+
+CsvWriter& CsvWriter::operator<<(float value) {
+    return appendFloat(value);
+}
+
+CsvWriter& CsvWriter::operator<<(double value) {
+    return appendFloat(value);
+}
+
+template<typename T>
+CsvWriter& CsvWriter::appendInteger(T value) {
+    char text[24];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    m_buffer.append(text, result.ptr - text);
+    return *this;
+}
+
+template<typename T>
+CsvWriter& CsvWriter::appendFloat(T value) {
+    // General format with 6 significant digits is what std::ostream uses by default
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value, std::chars_format::general, 6);
+    m_buffer.append(text, result.ptr - text);
+    return *this;
+}
+
+void CsvWriter::EndRow() {
+    m_buffer.push_back('\n');
+
+    if(m_buffer.size() >= m_flushBytes) {
+        Flush();
+    }
+    else if(std::chrono::steady_clock::now() - m_lastFlush >= m_flushInterval) {
+        Flush();
+    }
+}
+
+void CsvWriter::Flush() {
+    m_lastFlush = std::chrono::steady_clock::now();
+
+    if(m_file == NULL || m_buffer.empty()) {
+        return;
+    }
+
+    if(!m_fullBuffers.Push(std::move(m_buffer))) {
+        printf("Error! Writing to output file failed!\n");
+        m_writeFailed = true;
+    }
+
+    // Reuse a buffer the background thread has finished with, or make a new one
+    if(!m_freeBuffers.TryPop(m_buffer, std::chrono::milliseconds(0))) {
+        m_buffer = std::string();
+        m_buffer.reserve(m_flushBytes + ROW_MARGIN);
+    }
+}
+
+// Background thread: write filled buffers to the file
+void CsvWriter::writeBuffers() {
+    std::string buffer;
+    while(m_fullBuffers.Pop(buffer)) {
+        if(!m_writeFailed && fwrite(buffer.data(), 1, buffer.size(), m_file) != buffer.size()) {
+            printf("Error! Writing to output file failed!\n");
+            m_writeFailed = true;
+        }
+
+        buffer.clear();
+        m_freeBuffers.Push(std::move(buffer));
+    }
+}
@@ -0,0 +1,76 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * CsvWriter.h
+ * Contains a buffered output file writer that formats rows in memory
+ * and writes them to disk on a background thread.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "BoundedQueue.h"
+
+class CsvWriter {
+public:
+    // Hand the buffer to the background thread once it holds this many bytes
+    static const size_t DEFAULT_FLUSH_BYTES = 1 << 20;
+    // Hand the buffer to the background thread at least this often while rows are being written
+    static const int DEFAULT_FLUSH_INTERVAL_MS = 1000;
+
+    explicit CsvWriter(size_t flushBytes = DEFAULT_FLUSH_BYTES, int flushIntervalMs = DEFAULT_FLUSH_INTERVAL_MS);
+    ~CsvWriter();
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    // Open the file for writing and start the background thread. A file that is still open is closed first.
+    bool Open(const std::string& fileName);
+    bool IsOpen() const { return m_file != NULL; }
+    // Write everything still buffered, then close the file
+    void Close();
+
+    // Append text or a number to the current row. Numbers are formatted the same way
+    // as a default std::ostream formats them, so files match the earlier output.
+    CsvWriter& operator<<(const char* text);
+    CsvWriter& operator<<(const std::string& text);
+    CsvWriter& operator<<(char c);
+    CsvWriter& operator<<(int value);
+    CsvWriter& operator<<(unsigned int value);
+    CsvWriter& operator<<(long long value);
+    CsvWriter& operator<<(unsigned long long value);
+    CsvWriter& operator<<(float value);
+    CsvWriter& operator<<(double value);
+
+    // End the current row and hand the buffer to the background thread if the flush policy says so
+    void EndRow();
+    // Hand the buffer to the background thread now
+    void Flush();
+
+private:
+    template<typename T>
+    CsvWriter& appendInteger(T value);
+    template<typename T>
+    CsvWriter& appendFloat(T value);
+
+    void writeBuffers();
+
+    const size_t m_flushBytes;
+    const std::chrono::milliseconds m_flushInterval;
+    std::chrono::steady_clock::time_point m_lastFlush;
+
+    std::FILE* m_file = NULL;
+    bool m_writeFailed = false;
+    std::string m_buffer;
+
+    // Filled buffers wait in m_fullBuffers for the background thread, which returns them
+    // empty through m_freeBuffers so their memory is reused
+    BoundedQueue<std::string> m_fullBuffers;
+    BoundedQueue<std::string> m_freeBuffers;
+    std::thread m_writerThread;
+};
@@ -0,0 +1,286 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * JointAngles.cpp
+ * Contains the table of joint angles written to the output, its config
+ * file format, and the batched calculation of every angle of a frame.
+ */
+
+#define _USE_MATH_DEFINES
+#include <cfloat>
+#include <cmath>
+
+#include <fstream>
+
+#include <BodyTrackingHelpers.h>
+
+#include "SkeletonFile.h"
+#include "JointAngles.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define JOINT_ANGLES_SSE2
+#include <emmintrin.h>
+#endif
+
+// Angles are calculated in batches of this many, one per SIMD lane
+const size_t JOINT_ANGLE_BATCH = 4;
+
+// Remove spaces, tabs and carriage returns from both ends of a config file field
+std::string trimAngleField(const std::string& field) {
+    size_t start = field.find_first_not_of(" \t\r");
+    if(start == std::string::npos) {
+        return "";
+    }
+    size_t end = field.find_last_not_of(" \t\r");
+    return field.substr(start, end - start + 1);
+}
+
+// Find a joint by its name in g_jointNames, e.g. ELBOW_LEFT
+bool findJointByName(const std::string& name, k4abt_joint_id_t& joint) {
+    for(const auto& jointName : g_jointNames) {
+        if(jointName.second == name) {
+            joint = jointName.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+JointAngleTable::JointAngleTable() {
+    m_definitions = {
+        {"Left Elbow", {K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_SHOULDER_LEFT}},
+        {"Right Elbow", {K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT}},
+        {"Left Knee", {K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT}},
+        {"Right Knee", {K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT}}
+    };
+}
+
+bool JointAngleTable::Load(const std::string& fileName, std::string& errorText) {
+    std::ifstream file(fileName);
+    if(!file.is_open()) {
+        errorText = "Open angle file " + fileName + " failed.";
+        return false;
+    }
+
+    std::vector<JointAngleDefinition> definitions;
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line)) {
+        lineNumber++;
+        std::string trimmedLine = trimAngleField(line);
+        if(trimmedLine.empty() || trimmedLine[0] == '#') {
+            continue;
+        }
+
+        std::string location = fileName + " line " + std::to_string(lineNumber);
+
+        // Split the line into the name and the three joints
+        std::vector<std::string> fields;
+        size_t start = 0;
+        size_t comma;
+        while((comma = trimmedLine.find(',', start)) != std::string::npos) {
+            fields.push_back(trimAngleField(trimmedLine.substr(start, comma - start)));
+            start = comma + 1;
+        }
+        fields.push_back(trimAngleField(trimmedLine.substr(start)));
+
+        if(fields.size() != 4) {
+            errorText = location + ": expected Name, FIRST_JOINT, VERTEX_JOINT, LAST_JOINT.";
+            return false;
+        }
+
+        JointAngleDefinition definition;
+        definition.Name = fields[0];
+        // Names become CSV column names, so they cannot contain quotes
+        if(definition.Name.empty() || definition.Name.find('"') != std::string::npos) {
+            errorText = location + ": angle name must not be empty or contain quotes.";
+            return false;
+        }
+
+        for(int i = 0; i < 3; i++) {
+            if(!findJointByName(fields[i + 1], definition.Joints[i])) {
+                errorText = location + ": unknown joint " + fields[i + 1] + ".";
+                return false;
+            }
+        }
+
+        if(definition.Joints[0] == definition.Joints[1] || definition.Joints[2] == definition.Joints[1]) {
+            errorText = location + ": the vertex joint must differ from the first and last joint.";
+            return false;
+        }
+
+        definitions.push_back(definition);
+    }
+
+    if(definitions.empty()) {
+        errorText = "Angle file " + fileName + " does not define any angles.";
+        return false;
+    }
+    if(definitions.size() > JOINT_ANGLE_MAX_COUNT) {
+        errorText = "Angle file " + fileName + " defines more than " + std::to_string(JOINT_ANGLE_MAX_COUNT) + " angles.";
+        return false;
+    }
+
+    m_definitions = definitions;
+    return true;
+}
+
+// Position and confidence of a tracker joint or a recorded joint
+inline const float* jointPosition(const k4abt_joint_t& joint) { return joint.position.v; }
+inline const float* jointPosition(const SkeletonJointRecord& joint) { return joint.Position; }
+inline uint32_t jointConfidence(const k4abt_joint_t& joint) { return (uint32_t) joint.confidence_level; }
+inline uint32_t jointConfidence(const SkeletonJointRecord& joint) { return joint.Confidence; }
+
+void JointAngleCalculator::Compute(const k4abt_body_t* bodies, size_t bodyCount) {
+    reserve(bodyCount);
+    for(size_t i = 0; i < bodyCount; i++) {
+        gather(i, bodies[i].skeleton.joints);
+    }
+    computeAngles(bodyCount * m_table.Count());
+}
+
+void JointAngleCalculator::Compute(const SkeletonRecord* records, size_t recordCount) {
+    reserve(recordCount);
+    for(size_t i = 0; i < recordCount; i++) {
+        gather(i, records[i].Joints);
+    }
+    computeAngles(recordCount * m_table.Count());
+}
+
+void JointAngleCalculator::reserve(size_t itemCount) {
+    size_t angleCount = itemCount * m_table.Count();
+    size_t paddedCount = (angleCount + JOINT_ANGLE_BATCH - 1) / JOINT_ANGLE_BATCH * JOINT_ANGLE_BATCH;
+    if(m_angles.size() >= paddedCount) {
+        return;
+    }
+
+    m_ax.resize(paddedCount);
+    m_ay.resize(paddedCount);
+    m_az.resize(paddedCount);
+    m_bx.resize(paddedCount);
+    m_by.resize(paddedCount);
+    m_bz.resize(paddedCount);
+    m_valid.resize(paddedCount);
+    m_angles.resize(paddedCount);
+}
+
+template<typename Joint>
+void JointAngleCalculator::gather(size_t item, const Joint* joints) {
+    size_t angleCount = m_table.Count();
+    for(size_t k = 0; k < angleCount; k++) {
+        const JointAngleDefinition& definition = m_table[k];
+        const Joint& firstJoint = joints[definition.Joints[0]];
+        const Joint& vertexJoint = joints[definition.Joints[1]];
+        const Joint& lastJoint = joints[definition.Joints[2]];
+        const float* first = jointPosition(firstJoint);
+        const float* vertex = jointPosition(vertexJoint);
+        const float* last = jointPosition(lastJoint);
+
+        size_t i = item * angleCount + k;
+        m_ax[i] = first[0] - vertex[0];
+        m_ay[i] = first[1] - vertex[1];
+        m_az[i] = first[2] - vertex[2];
+        m_bx[i] = last[0] - vertex[0];
+        m_by[i] = last[1] - vertex[1];
+        m_bz[i] = last[2] - vertex[2];
+
+        // An angle is only measured if the tracker has a position for all three joints
+        bool tracked = jointConfidence(firstJoint) != K4ABT_JOINT_CONFIDENCE_NONE && jointConfidence(vertexJoint) != K4ABT_JOINT_CONFIDENCE_NONE &&
+                       jointConfidence(lastJoint) != K4ABT_JOINT_CONFIDENCE_NONE;
+        m_valid[i] = tracked ? UINT32_MAX : 0;
+    }
+}
+
+// Coefficients of the arctangent polynomial for arguments up to tan(pi/8), from the Cephes atanf
+const float ATAN_COEFFICIENT_7 = 8.05374449538e-2f;
+const float ATAN_COEFFICIENT_5 = -1.38776856032e-1f;
+const float ATAN_COEFFICIENT_3 = 1.99777106478e-1f;
+const float ATAN_COEFFICIENT_1 = -3.33329491539e-1f;
+const float TAN_PI_8 = 0.414213562373f;
+const float RADIAN_TO_DEGREE = (float) (180.0 / M_PI);
+
+void JointAngleCalculator::computeAngles(size_t angleCount) {
+    // The angle between segments a and b is atan2(|a x b|, a . b), which stays accurate near 0 and 180 degrees where acos
+    // of the normalized dot product loses precision, and cannot leave its domain through rounding. atan2 is evaluated
+    // without branches: the ratio of the smaller to the larger argument is reduced to at most tan(pi/8) for the
+    // polynomial, and the octant is restored with selects, so every lane follows the same path.
+    size_t i = 0;
+#ifdef JOINT_ANGLES_SSE2
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 invalid = _mm_set1_ps(JOINT_ANGLE_INVALID);
+
+    // Pick a where mask is set and b elsewhere
+    auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+    // The buffers are padded to a whole batch
+    for(; i < angleCount; i += JOINT_ANGLE_BATCH) {
+        __m128 ax = _mm_loadu_ps(&m_ax[i]);
+        __m128 ay = _mm_loadu_ps(&m_ay[i]);
+        __m128 az = _mm_loadu_ps(&m_az[i]);
+        __m128 bx = _mm_loadu_ps(&m_bx[i]);
+        __m128 by = _mm_loadu_ps(&m_by[i]);
+        __m128 bz = _mm_loadu_ps(&m_bz[i]);
+
+        __m128 crossX = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+        __m128 crossY = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+        __m128 crossZ = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+        __m128 y = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(crossX, crossX), _mm_mul_ps(crossY, crossY)), _mm_mul_ps(crossZ, crossZ)));
+        __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+        __m128 absX = _mm_andnot_ps(signMask, x);
+
+        // Both arguments are 0 only for a segment without length, which is invalid, so the ratio never divides by 0
+        __m128 maxArgument = _mm_max_ps(absX, y);
+        __m128 t = _mm_div_ps(_mm_min_ps(absX, y), _mm_max_ps(maxArgument, _mm_set1_ps(FLT_MIN)));
+
+        __m128 reduce = _mm_cmpgt_ps(t, _mm_set1_ps(TAN_PI_8));
+        t = select(reduce, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one)), t);
+        __m128 z = _mm_mul_ps(t, t);
+        __m128 polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ATAN_COEFFICIENT_7), z), _mm_set1_ps(ATAN_COEFFICIENT_5));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z), _mm_set1_ps(ATAN_COEFFICIENT_3));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z), _mm_set1_ps(ATAN_COEFFICIENT_1));
+        __m128 angle = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(polynomial, z), t), t);
+        angle = _mm_add_ps(angle, _mm_and_ps(reduce, _mm_set1_ps((float) M_PI_4)));
+
+        angle = select(_mm_cmpgt_ps(y, absX), _mm_sub_ps(_mm_set1_ps((float) M_PI_2), angle), angle);
+        angle = select(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps((float) M_PI), angle), angle);
+        angle = _mm_mul_ps(angle, _mm_set1_ps(RADIAN_TO_DEGREE));
+
+        // Untracked joints and segments without length have no angle
+        __m128 aLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az));
+        __m128 bLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by)), _mm_mul_ps(bz, bz));
+        __m128 valid = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) &m_valid[i]));
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(aLength, zero), _mm_cmpgt_ps(bLength, zero)));
+        _mm_storeu_ps(&m_angles[i], select(valid, angle, invalid));
+    }
+#else
+    for(; i < angleCount; i++) {
+        float crossX = m_ay[i] * m_bz[i] - m_az[i] * m_by[i];
+        float crossY = m_az[i] * m_bx[i] - m_ax[i] * m_bz[i];
+        float crossZ = m_ax[i] * m_by[i] - m_ay[i] * m_bx[i];
+        float y = sqrtf(crossX * crossX + crossY * crossY + crossZ * crossZ);
+        float x = m_ax[i] * m_bx[i] + m_ay[i] * m_by[i] + m_az[i] * m_bz[i];
+        float absX = fabsf(x);
+
+        float maxArgument = absX > y ? absX : y;
+        float t = (absX < y ? absX : y) / (maxArgument > FLT_MIN ? maxArgument : FLT_MIN);
+
+        bool reduce = t > TAN_PI_8;
+        t = reduce ? (t - 1.0f) / (t + 1.0f) : t;
+        float z = t * t;
+        float polynomial = ((ATAN_COEFFICIENT_7 * z + ATAN_COEFFICIENT_5) * z + ATAN_COEFFICIENT_3) * z + ATAN_COEFFICIENT_1;
+        float angle = polynomial * z * t + t + (reduce ? (float) M_PI_4 : 0.0f);
+
+        angle = y > absX ? (float) M_PI_2 - angle : angle;
+        angle = x < 0.0f ? (float) M_PI - angle : angle;
+        angle *= RADIAN_TO_DEGREE;
+
+        float aLength = m_ax[i] * m_ax[i] + m_ay[i] * m_ay[i] + m_az[i] * m_az[i];
+        float bLength = m_bx[i] * m_bx[i] + m_by[i] * m_by[i] + m_bz[i] * m_bz[i];
+        bool valid = m_valid[i] != 0 && aLength > 0.0f && bLength > 0.0f;
+        m_angles[i] = valid ? angle : JOINT_ANGLE_INVALID;
+    }
+#endif
+}
@@ -0,0 +1,92 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * JointAngles.h
+ * Contains the table of joint angles written to the output, its config
+ * file format, and the batched calculation of every angle of a frame.
+ *
+ * Config file format, one angle per line:
+ *   Name, FIRST_JOINT, VERTEX_JOINT, LAST_JOINT
+ * Joints use the names of g_jointNames, e.g. WRIST_LEFT. The angle is measured at the vertex joint,
+ * between the segments to the first and the last joint. Empty lines and lines starting with # are skipped.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <k4abt.h>
+
+struct SkeletonRecord;
+
+// Upper limit of angles in a table, so a config file cannot make every row of output unreasonably wide
+const size_t JOINT_ANGLE_MAX_COUNT = 256;
+
+// Value of an angle that cannot be measured, because the tracker has no position for one of its joints
+// (confidence NONE) or one of its segments has no length
+const float JOINT_ANGLE_INVALID = std::numeric_limits<float>::quiet_NaN();
+
+inline bool IsJointAngleValid(float angle) { return !std::isnan(angle); }
+
+// An angle at Joints[1] between the segments to Joints[0] and Joints[2]
+struct JointAngleDefinition {
+    std::string Name; // Output column is "<Name> Angle"
+    k4abt_joint_id_t Joints[3];
+};
+
+// Angles written to the output, in column order. Without a config file these are the left and right elbow and knee angles.
+class JointAngleTable {
+public:
+    JointAngleTable();
+
+    // Replace the angles with the ones in a config file. The table is unchanged if the file cannot be read or has an error.
+    bool Load(const std::string& fileName, std::string& errorText);
+    void Add(const JointAngleDefinition& definition) { m_definitions.push_back(definition); }
+    void Clear() { m_definitions.clear(); }
+
+    size_t Count() const { return m_definitions.size(); }
+    const JointAngleDefinition& operator[](size_t index) const { return m_definitions[index]; }
+
+private:
+    std::vector<JointAngleDefinition> m_definitions;
+};
+
+// Calculates every angle of a table for every body of a frame in one batch. The segments of all angles are gathered
+// into structure of arrays form first, so the angle math runs four angles at a time however the table is laid out.
+// Angles are in degrees from 0 to 180, or JOINT_ANGLE_INVALID. Buffers keep their memory between frames.
+class JointAngleCalculator {
+public:
+    JointAngleCalculator() = default;
+    explicit JointAngleCalculator(const JointAngleTable& table) : m_table(table) {}
+
+    const JointAngleTable& Table() const { return m_table; }
+    void SetTable(const JointAngleTable& table) { m_table = table; }
+
+    void Compute(const k4abt_body_t* bodies, size_t bodyCount);
+    void Compute(const SkeletonRecord* records, size_t recordCount);
+
+    // Angles in degrees of a body or record of the last Compute call, in table order
+    const float* Angles(size_t index) const { return m_angles.data() + index * m_table.Count(); }
+
+private:
+    // Size the buffers for itemCount bodies or records, padded to a whole batch
+    void reserve(size_t itemCount);
+    // Gather the segments and tracking state of every angle of one item from its joints
+    template<typename Joint>
+    void gather(size_t item, const Joint* joints);
+    void computeAngles(size_t angleCount);
+
+    JointAngleTable m_table;
+
+    // Segments from the vertex joint to the first (A) and last (B) joint of every angle of every item
+    std::vector<float> m_ax, m_ay, m_az;
+    std::vector<float> m_bx, m_by, m_bz;
+    std::vector<uint32_t> m_valid; // All bits set if the tracker has a position for all three joints
+    std::vector<float> m_angles;
+};
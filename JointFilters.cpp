@@ -0,0 +1,381 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * JointFilters.cpp
+ * Contains the smoothing filters applied to the joint positions of each
+ * tracked body after body tracking: One Euro, constant velocity Kalman
+ * and Savitzky-Golay with bounded lookahead.
+ */
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <algorithm>
+
+#include "JointFilters.h"
+
+// Filter parameters derived from the smoothing factor s from 0 to 1. Positions are in millimeters.
+const float ONE_EURO_MAX_CUTOFF = 10.0f; // Minimum cutoff in Hz at s = 0, falling to a hundredth at s = 1
+const float ONE_EURO_BETA = 0.01f; // Cutoff increase in Hz per mm/s of speed
+const float ONE_EURO_DERIVATIVE_CUTOFF = 1.0f; // Hz
+const float KALMAN_MEASUREMENT_VARIANCE = 25.0f; // mm^2, about the noise of the body tracker
+const float KALMAN_MAX_PROCESS_NOISE = 1e8f; // Acceleration noise in mm^2/s^3 at s = 0, falling to a millionth at s = 1
+const float KALMAN_INITIAL_VELOCITY_VARIANCE = 1e6f; // (mm/s)^2
+const size_t SAVITZKY_GOLAY_MIN_PAST = 2; // Past frames in the window at s = 0, rising to the maximum at s = 1
+const size_t SAVITZKY_GOLAY_MAX_PAST = SAVITZKY_GOLAY_MIN_PAST + 8;
+const size_t SAVITZKY_GOLAY_MAX_WINDOW = SAVITZKY_GOLAY_MAX_PAST + JOINT_FILTER_MAX_LOOKAHEAD + 1;
+const size_t SAVITZKY_GOLAY_MAX_DEGREE = 2;
+
+const char* GetJointFilterName(JointFilterType type) {
+    switch(type) {
+        case JointFilterType::OneEuro:
+            return "One Euro";
+        case JointFilterType::Kalman:
+            return "Kalman";
+        case JointFilterType::SavitzkyGolay:
+            return "Savitzky-Golay";
+        case JointFilterType::None:
+        default:
+            return "None";
+    }
+}
+
+// Smoothing factor of an exponential filter with the passed cutoff frequency and time step
+inline float oneEuroAlpha(float cutoff, float step) {
+    float tau = 1.0f / (2.0f * (float) M_PI * cutoff);
+    return 1.0f / (1.0f + tau / step);
+}
+
+void JointFilter::Reset(const JointFilterSettings& settings) {
+    m_settings = settings;
+    m_settings.Smoothing = std::min(std::max(m_settings.Smoothing, 0.0f), 1.0f);
+    m_settings.Lookahead = std::min(std::max(m_settings.Lookahead, 0), JOINT_FILTER_MAX_LOOKAHEAD);
+    if(m_settings.Type != JointFilterType::SavitzkyGolay) {
+        m_settings.Lookahead = 0;
+    }
+
+    m_pastSamples = SAVITZKY_GOLAY_MIN_PAST + (size_t) lroundf((SAVITZKY_GOLAY_MAX_PAST - SAVITZKY_GOLAY_MIN_PAST) * m_settings.Smoothing);
+    m_sampleCapacity = m_pastSamples + m_settings.Lookahead + 1;
+    m_newestFrame = 0;
+    m_states.clear();
+    m_pendingStart = 0;
+    m_pendingCount = 0;
+}
+
+JointFilter::BodyState* JointFilter::findState(uint32_t bodyId) {
+    for(BodyState& state : m_states) {
+        if(state.Active && state.BodyId == bodyId) {
+            return &state;
+        }
+    }
+    return NULL;
+}
+
+JointFilter::BodyState& JointFilter::updateState(uint32_t bodyId, uint64_t timestamp, bool& restarted) {
+    BodyState* state = findState(bodyId);
+    if(state != NULL) {
+        // Start over after a gap, or if time went backwards because a recording was restarted.
+        // Records before the restart are filtered with the samples they have, before those samples are dropped.
+        restarted = timestamp <= state->LastTimestamp || timestamp - state->LastTimestamp > JOINT_FILTER_MAX_GAP_USEC;
+        if(restarted) {
+            filterPendingBody(state->BodyId);
+        }
+    }
+    else {
+        // Reuse the state of a body that left. At low frame rates its last records can still be waiting for
+        // their lookahead frames, so they are filtered before the state is taken over.
+        for(BodyState& candidate : m_states) {
+            if(!candidate.Active || timestamp > candidate.LastTimestamp + JOINT_FILTER_MAX_GAP_USEC) {
+                if(candidate.Active) {
+                    filterPendingBody(candidate.BodyId);
+                }
+                state = &candidate;
+                break;
+            }
+        }
+
+        if(state == NULL) {
+            m_states.emplace_back();
+            state = &m_states.back();
+            state->SampleFrames.resize(m_sampleCapacity);
+            state->SampleTimestamps.resize(m_sampleCapacity);
+            state->Samples.resize(m_sampleCapacity * COORDINATE_COUNT);
+        }
+
+        state->BodyId = bodyId;
+        state->Active = true;
+        restarted = true;
+    }
+
+    if(restarted) {
+        state->SampleCount = 0;
+    }
+    state->LastTimestamp = timestamp;
+    return *state;
+}
+
+void JointFilter::filterOneEuro(BodyState& state, const SkeletonRecord& raw, SkeletonRecord& filtered, bool restarted, float step) {
+    float minCutoff = ONE_EURO_MAX_CUTOFF * powf(0.01f, m_settings.Smoothing);
+    float derivativeAlpha = oneEuroAlpha(ONE_EURO_DERIVATIVE_CUTOFF, step);
+    for(size_t i = 0; i < COORDINATE_COUNT; i++) {
+        float position = raw.Joints[i / 3].Position[i % 3];
+        if(restarted) {
+            state.Position[i] = position;
+            state.Velocity[i] = 0.0f;
+        }
+        else {
+            // The cutoff follows the smoothed speed, so fast movement is not held back
+            float velocity = (position - state.Position[i]) / step;
+            state.Velocity[i] += derivativeAlpha * (velocity - state.Velocity[i]);
+            float cutoff = minCutoff + ONE_EURO_BETA * fabsf(state.Velocity[i]);
+            state.Position[i] += oneEuroAlpha(cutoff, step) * (position - state.Position[i]);
+        }
+        filtered.Joints[i / 3].Position[i % 3] = state.Position[i];
+    }
+}
+
+void JointFilter::filterKalman(BodyState& state, const SkeletonRecord& raw, SkeletonRecord& filtered, bool restarted, float step) {
+    float processNoise = KALMAN_MAX_PROCESS_NOISE * powf(1e-6f, m_settings.Smoothing);
+    float step2 = step * step;
+    float noisePosition = processNoise * step2 * step / 3;
+    float noiseCovariance = processNoise * step2 / 2;
+    float noiseVelocity = processNoise * step;
+
+    for(size_t i = 0; i < COORDINATE_COUNT; i++) {
+        float position = raw.Joints[i / 3].Position[i % 3];
+        float* covariance[3] = {&state.Covariance[0][i], &state.Covariance[1][i], &state.Covariance[2][i]};
+        if(restarted) {
+            state.Position[i] = position;
+            state.Velocity[i] = 0.0f;
+            *covariance[0] = KALMAN_MEASUREMENT_VARIANCE;
+            *covariance[1] = 0.0f;
+            *covariance[2] = KALMAN_INITIAL_VELOCITY_VARIANCE;
+        }
+        else {
+            // Predict with constant velocity
+            float p00 = *covariance[0] + step * (2 * *covariance[1] + step * *covariance[2]) + noisePosition;
+            float p01 = *covariance[1] + step * *covariance[2] + noiseCovariance;
+            float p11 = *covariance[2] + noiseVelocity;
+            float predicted = state.Position[i] + step * state.Velocity[i];
+
+            // Correct with the measured position
+            float innovation = position - predicted;
+            float gainPosition = p00 / (p00 + KALMAN_MEASUREMENT_VARIANCE);
+            float gainVelocity = p01 / (p00 + KALMAN_MEASUREMENT_VARIANCE);
+            state.Position[i] = predicted + gainPosition * innovation;
+            state.Velocity[i] += gainVelocity * innovation;
+            *covariance[0] = (1 - gainPosition) * p00;
+            *covariance[1] = (1 - gainPosition) * p01;
+            *covariance[2] = p11 - gainVelocity * p01;
+        }
+        filtered.Joints[i / 3].Position[i % 3] = state.Position[i];
+    }
+}
+
+void JointFilter::addSample(BodyState& state, const SkeletonRecord& raw, bool restarted) {
+    size_t newest = restarted || state.SampleCount == 0 ? 0 : (state.NewestSample + 1) % m_sampleCapacity;
+    float* sample = &state.Samples[newest * COORDINATE_COUNT];
+    for(size_t i = 0; i < COORDINATE_COUNT; i++) {
+        sample[i] = raw.Joints[i / 3].Position[i % 3];
+    }
+    state.SampleFrames[newest] = raw.Frame;
+    state.SampleTimestamps[newest] = raw.DeviceTimestampUsec;
+    state.NewestSample = newest;
+    state.SampleCount = std::min(state.SampleCount + 1, m_sampleCapacity);
+}
+
+void JointFilter::filterSavitzkyGolay(PendingRecord& pending) {
+    const SkeletonRecord& raw = pending.Raw;
+    BodyState* state = findState(raw.BodyId);
+    if(state == NULL) {
+        return;
+    }
+
+    // Gather the body's samples in the window around the frame, as offsets in seconds
+    size_t window[SAVITZKY_GOLAY_MAX_WINDOW];
+    double offsets[SAVITZKY_GOLAY_MAX_WINDOW];
+    size_t count = 0;
+    bool hasFrame = false;
+    for(size_t k = 0; k < state->SampleCount; k++) {
+        size_t index = (state->NewestSample + m_sampleCapacity - k) % m_sampleCapacity;
+        uint32_t frame = state->SampleFrames[index];
+        if(frame + m_pastSamples >= raw.Frame && frame <= raw.Frame + (uint32_t) m_settings.Lookahead) {
+            window[count] = index;
+            offsets[count] = ((double) state->SampleTimestamps[index] - (double) raw.DeviceTimestampUsec) / 1000000.0;
+            hasFrame = hasFrame || frame == raw.Frame;
+            count++;
+        }
+    }
+    if(!hasFrame) {
+        return;
+    }
+
+    // The filtered position is the value at offset 0 of the least squares polynomial through the window. It is a weighted sum
+    // of the samples with weights u0 + u1 x + u2 x^2, where u solves the normal equations M u = e0 with M[a][b] = sum of x^(a + b).
+    size_t degree = std::min(SAVITZKY_GOLAY_MAX_DEGREE, count - 1);
+    size_t size = degree + 1;
+    double powerSums[2 * SAVITZKY_GOLAY_MAX_DEGREE + 1] = {};
+    for(size_t j = 0; j < count; j++) {
+        double power = 1.0;
+        for(size_t p = 0; p <= 2 * degree; p++) {
+            powerSums[p] += power;
+            power *= offsets[j];
+        }
+    }
+
+    double matrix[SAVITZKY_GOLAY_MAX_DEGREE + 1][SAVITZKY_GOLAY_MAX_DEGREE + 2];
+    for(size_t a = 0; a < size; a++) {
+        for(size_t b = 0; b < size; b++) {
+            matrix[a][b] = powerSums[a + b];
+        }
+        matrix[a][size] = a == 0 ? 1.0 : 0.0;
+    }
+
+    // Gaussian elimination with partial pivoting. Samples with the same timestamp make the system singular.
+    for(size_t column = 0; column < size; column++) {
+        size_t pivot = column;
+        for(size_t row = column + 1; row < size; row++) {
+            if(fabs(matrix[row][column]) > fabs(matrix[pivot][column])) {
+                pivot = row;
+            }
+        }
+        if(fabs(matrix[pivot][column]) < 1e-18) {
+            return;
+        }
+        std::swap(matrix[column], matrix[pivot]);
+        for(size_t row = 0; row < size; row++) {
+            if(row != column) {
+                double factor = matrix[row][column] / matrix[column][column];
+                for(size_t k = column; k <= size; k++) {
+                    matrix[row][k] -= factor * matrix[column][k];
+                }
+            }
+        }
+    }
+
+    double solution[SAVITZKY_GOLAY_MAX_DEGREE + 1] = {};
+    for(size_t a = 0; a < size; a++) {
+        solution[a] = matrix[a][size] / matrix[a][a];
+    }
+
+    float weights[SAVITZKY_GOLAY_MAX_WINDOW];
+    for(size_t j = 0; j < count; j++) {
+        weights[j] = (float) (solution[0] + offsets[j] * (solution[1] + offsets[j] * solution[2]));
+    }
+
+    SkeletonRecord& filtered = pending.Filtered;
+    for(size_t i = 0; i < COORDINATE_COUNT; i++) {
+        float value = 0.0f;
+        for(size_t j = 0; j < count; j++) {
+            value += weights[j] * state->Samples[window[j] * COORDINATE_COUNT + i];
+        }
+        filtered.Joints[i / 3].Position[i % 3] = value;
+    }
+}
+
+JointFilter::PendingRecord& JointFilter::pushPending() {
+    // Grow the ring buffer in order when it is full
+    if(m_pendingCount == m_pending.size()) {
+        std::vector<PendingRecord> pending(std::max<size_t>(16, 2 * m_pending.size()));
+        for(size_t i = 0; i < m_pendingCount; i++) {
+            pending[i] = m_pending[(m_pendingStart + i) % m_pending.size()];
+        }
+        m_pending.swap(pending);
+        m_pendingStart = 0;
+    }
+
+    PendingRecord& record = m_pending[(m_pendingStart + m_pendingCount) % m_pending.size()];
+    m_pendingCount++;
+    return record;
+}
+
+void JointFilter::filterPending(bool flush) {
+    for(size_t i = 0; i < m_pendingCount; i++) {
+        PendingRecord& pending = m_pending[(m_pendingStart + i) % m_pending.size()];
+        if(pending.Ready) {
+            continue;
+        }
+        if(!flush && pending.Raw.Frame + (uint32_t) m_settings.Lookahead >= m_newestFrame) {
+            break;
+        }
+
+        filterSavitzkyGolay(pending);
+        pending.Ready = true;
+    }
+}
+
+void JointFilter::filterPendingBody(uint32_t bodyId) {
+    for(size_t i = 0; i < m_pendingCount; i++) {
+        PendingRecord& pending = m_pending[(m_pendingStart + i) % m_pending.size()];
+        if(!pending.Ready && pending.Raw.BodyId == bodyId) {
+            filterSavitzkyGolay(pending);
+            pending.Ready = true;
+        }
+    }
+}
+
+void JointFilter::Add(const SkeletonRecord& record) {
+    // Records of earlier frames are filtered once every record of the frames in their lookahead is in,
+    // which is known when the first record of a later frame arrives
+    if(record.Frame > m_newestFrame) {
+        m_newestFrame = record.Frame;
+        filterPending(false);
+    }
+
+    PendingRecord& pending = pushPending();
+    pending.Raw = record;
+    pending.Filtered = record;
+    pending.Ready = true;
+    if(record.BodyId == K4ABT_INVALID_BODY_ID) {
+        return;
+    }
+
+    BodyState* previous = findState(record.BodyId);
+    uint64_t lastTimestamp = previous != NULL ? previous->LastTimestamp : 0;
+    bool restarted = false;
+    BodyState& state = updateState(record.BodyId, record.DeviceTimestampUsec, restarted);
+    float step = restarted ? 0.0f : (float) ((record.DeviceTimestampUsec - lastTimestamp) / 1000000.0);
+
+    switch(m_settings.Type) {
+        case JointFilterType::OneEuro:
+            filterOneEuro(state, record, pending.Filtered, restarted, step);
+            break;
+        case JointFilterType::Kalman:
+            filterKalman(state, record, pending.Filtered, restarted, step);
+            break;
+        case JointFilterType::SavitzkyGolay:
+            addSample(state, record, restarted);
+            if(m_settings.Lookahead == 0) {
+                filterSavitzkyGolay(pending);
+            }
+            else {
+                pending.Ready = false;
+            }
+            break;
+        case JointFilterType::None:
+        default:
+            break;
+    }
+}
+
+bool JointFilter::Take(SkeletonRecord& filtered, SkeletonRecord& raw) {
+    if(m_pendingCount == 0) {
+        return false;
+    }
+
+    PendingRecord& pending = m_pending[m_pendingStart];
+    if(!pending.Ready) {
+        return false;
+    }
+
+    filtered = pending.Filtered;
+    raw = pending.Raw;
+    m_pendingStart = (m_pendingStart + 1) % m_pending.size();
+    m_pendingCount--;
+    return true;
+}
+
+void JointFilter::Flush() {
+    filterPending(true);
+}
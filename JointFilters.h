@@ -0,0 +1,109 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * JointFilters.h
+ * Contains the smoothing filters applied to the joint positions of each
+ * tracked body after body tracking: One Euro, constant velocity Kalman
+ * and Savitzky-Golay with bounded lookahead.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <k4abt.h>
+
+#include "SkeletonFile.h"
+
+// Filter applied to joint positions before angles are calculated
+enum class JointFilterType {
+    None,
+    OneEuro, // Low-pass filter whose cutoff rises with speed, so slow movement is smoothed without lagging fast movement
+    Kalman, // Constant velocity Kalman filter of each coordinate
+    SavitzkyGolay // Quadratic least squares fit over recent and a few future frames, which delays the output by as many frames
+};
+
+const int JOINT_FILTER_MAX_LOOKAHEAD = 5; // Frames
+const uint64_t JOINT_FILTER_MAX_GAP_USEC = 200000; // A body not seen for longer starts over
+
+struct JointFilterSettings {
+    JointFilterType Type = JointFilterType::None;
+    float Smoothing = 0.5f; // From 0 for the least to 1 for the most smoothing
+    int Lookahead = 2; // Future frames used by the Savitzky-Golay filter, up to JOINT_FILTER_MAX_LOOKAHEAD
+};
+
+// Name of a filter type for messages
+const char* GetJointFilterName(JointFilterType type);
+
+// Filters the joint positions of each body from record to record. Orientations and confidences are kept.
+// Records come out in the order they went in; with a lookahead, each one comes out once the records of
+// the following frames are in. Memory is only allocated until every body and pending record has a place.
+class JointFilter {
+public:
+    void Reset(const JointFilterSettings& settings);
+
+    // Add the next record. Records have to be added in frame order; records without body data are passed through.
+    void Add(const SkeletonRecord& record);
+    // Take the oldest record whose filtered joints are ready, along with the record as it was added
+    bool Take(SkeletonRecord& filtered, SkeletonRecord& raw);
+    // Filter every record still waiting for future frames, after the last one was added
+    void Flush();
+
+private:
+    static const size_t COORDINATE_COUNT = 3 * K4ABT_JOINT_COUNT;
+
+    // Filter state of one body. States of bodies that left are reused by new ones.
+    struct BodyState {
+        uint32_t BodyId = 0;
+        bool Active = false;
+        uint64_t LastTimestamp = 0;
+
+        // One Euro: filtered position and derivative. Kalman: position, velocity and covariance.
+        float Position[COORDINATE_COUNT];
+        float Velocity[COORDINATE_COUNT];
+        float Covariance[3][COORDINATE_COUNT]; // Position variance, covariance and velocity variance
+
+        // Savitzky-Golay: ring buffer of recent positions
+        size_t SampleCount = 0;
+        size_t NewestSample = 0;
+        std::vector<uint32_t> SampleFrames;
+        std::vector<uint64_t> SampleTimestamps;
+        std::vector<float> Samples;
+    };
+
+    struct PendingRecord {
+        SkeletonRecord Raw;
+        SkeletonRecord Filtered;
+        bool Ready;
+    };
+
+    BodyState* findState(uint32_t bodyId);
+    // Find the state of a body or a free one for it, starting over after a gap
+    BodyState& updateState(uint32_t bodyId, uint64_t timestamp, bool& restarted);
+
+    void filterOneEuro(BodyState& state, const SkeletonRecord& raw, SkeletonRecord& filtered, bool restarted, float step);
+    void filterKalman(BodyState& state, const SkeletonRecord& raw, SkeletonRecord& filtered, bool restarted, float step);
+    void addSample(BodyState& state, const SkeletonRecord& raw, bool restarted);
+    void filterSavitzkyGolay(PendingRecord& pending);
+
+    // Filter the pending records whose lookahead frames are all in
+    void filterPending(bool flush);
+    // Filter the pending records of a body now, before its state starts over or is reused by another body
+    void filterPendingBody(uint32_t bodyId);
+    PendingRecord& pushPending();
+
+    JointFilterSettings m_settings;
+    size_t m_pastSamples = 0; // Savitzky-Golay window before the filtered frame
+    size_t m_sampleCapacity = 0;
+    uint32_t m_newestFrame = 0;
+
+    std::vector<BodyState> m_states;
+
+    // Ring buffer of records in the order they were added
+    std::vector<PendingRecord> m_pending;
+    size_t m_pendingStart = 0;
+    size_t m_pendingCount = 0;
+};
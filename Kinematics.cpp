@@ -0,0 +1,106 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * Kinematics.cpp
+ * Contains the streaming calculation of joint and angle velocities and
+ * accelerations of each tracked body from its recent records.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "SkeletonFile.h"
+#include "Kinematics.h"
+
+const float KINEMATICS_UNKNOWN = std::numeric_limits<float>::quiet_NaN();
+
+void KinematicsTracker::Reset(size_t angleCount) {
+    m_valueCount = 3 * K4ABT_JOINT_COUNT + angleCount;
+    m_histories.clear();
+    m_velocity.assign(m_valueCount, KINEMATICS_UNKNOWN);
+    m_acceleration.assign(m_valueCount, KINEMATICS_UNKNOWN);
+}
+
+KinematicsTracker::BodyHistory& KinematicsTracker::findHistory(uint32_t bodyId, uint64_t timestamp) {
+    // Bodies are few, so a linear search is faster than a map and never allocates
+    BodyHistory* freeHistory = NULL;
+    for(BodyHistory& history : m_histories) {
+        if(history.Count > 0 && history.BodyId == bodyId) {
+            return history;
+        }
+
+        // The body of a history that was not updated for a while has left
+        if(freeHistory == NULL && (history.Count == 0 || timestamp > history.Timestamps[history.Newest] + KINEMATICS_MAX_GAP_USEC)) {
+            freeHistory = &history;
+        }
+    }
+
+    if(freeHistory == NULL) {
+        m_histories.emplace_back();
+        freeHistory = &m_histories.back();
+        freeHistory->Samples.resize(KINEMATICS_HISTORY * m_valueCount);
+    }
+
+    freeHistory->BodyId = bodyId;
+    freeHistory->Count = 0;
+    return *freeHistory;
+}
+
+void KinematicsTracker::Update(const SkeletonRecord& record, const float* angles) {
+    uint64_t timestamp = record.DeviceTimestampUsec;
+    BodyHistory& history = findHistory(record.BodyId, timestamp);
+
+    // Start over after a gap, or if time went backwards because a recording was restarted
+    if(history.Count > 0) {
+        uint64_t lastTimestamp = history.Timestamps[history.Newest];
+        if(timestamp <= lastTimestamp || timestamp - lastTimestamp > KINEMATICS_MAX_GAP_USEC) {
+            history.Count = 0;
+        }
+    }
+
+    // Add the record as the newest sample, with joint positions converted from millimeters to meters
+    size_t newest = history.Count == 0 ? 0 : (history.Newest + 1) % KINEMATICS_HISTORY;
+    float* sample = &history.Samples[newest * m_valueCount];
+    for(int i = 0; i < K4ABT_JOINT_COUNT; i++) {
+        for(int k = 0; k < 3; k++) {
+            sample[3 * i + k] = record.Joints[i].Position[k] / 1000;
+        }
+    }
+    memcpy(sample + 3 * K4ABT_JOINT_COUNT, angles, (m_valueCount - 3 * K4ABT_JOINT_COUNT) * sizeof(float));
+    history.Timestamps[newest] = timestamp;
+    history.Newest = newest;
+    history.Count = std::min(history.Count + 1, KINEMATICS_HISTORY);
+
+    std::fill(m_velocity.begin(), m_velocity.end(), KINEMATICS_UNKNOWN);
+    std::fill(m_acceleration.begin(), m_acceleration.end(), KINEMATICS_UNKNOWN);
+    if(history.Count < 2) {
+        return;
+    }
+
+    // Velocity is the backward difference to the previous sample
+    size_t previous = (newest + KINEMATICS_HISTORY - 1) % KINEMATICS_HISTORY;
+    const float* previousSample = &history.Samples[previous * m_valueCount];
+    double step = (timestamp - history.Timestamps[previous]) / 1000000.0;
+    float inverseStep = (float) (1.0 / step);
+    for(size_t i = 0; i < m_valueCount; i++) {
+        m_velocity[i] = (sample[i] - previousSample[i]) * inverseStep;
+    }
+
+    if(history.Count < 3) {
+        return;
+    }
+
+    // Acceleration is the change from the previous velocity over the time between the midpoints of both steps,
+    // which is the second difference for uneven time steps
+    size_t oldest = (newest + KINEMATICS_HISTORY - 2) % KINEMATICS_HISTORY;
+    const float* oldestSample = &history.Samples[oldest * m_valueCount];
+    double previousStep = (history.Timestamps[previous] - history.Timestamps[oldest]) / 1000000.0;
+    float inversePreviousStep = (float) (1.0 / previousStep);
+    float inverseMidpointStep = (float) (2.0 / (step + previousStep));
+    for(size_t i = 0; i < m_valueCount; i++) {
+        float previousVelocity = (previousSample[i] - oldestSample[i]) * inversePreviousStep;
+        m_acceleration[i] = (m_velocity[i] - previousVelocity) * inverseMidpointStep;
+    }
+}
@@ -0,0 +1,58 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * Kinematics.h
+ * Contains the streaming calculation of joint and angle velocities and
+ * accelerations of each tracked body from its recent records.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <k4abt.h>
+
+struct SkeletonRecord;
+
+const size_t KINEMATICS_HISTORY = 3; // Records kept per body, enough for a second difference
+const uint64_t KINEMATICS_MAX_GAP_USEC = 200000; // A body not seen for longer starts a new history
+
+// Finite difference velocities and accelerations of every joint and angle of each tracked body. Each body keeps
+// a ring buffer of its last few records, so a record costs the same however long the session is. Time steps come
+// from the device timestamps, so dropped frames do not distort the derivatives.
+class KinematicsTracker {
+public:
+    // Forget every body and prepare for records with angleCount angles
+    void Reset(size_t angleCount);
+
+    // Add the next record of a body and calculate its derivatives. Records of each body have to be added in order.
+    void Update(const SkeletonRecord& record, const float* angles);
+
+    // Derivatives of the last updated body: joints in m/s and m/s^2, angles in degrees/s and degrees/s^2.
+    // Values are NaN until the body has enough history, or if one of the angles involved is invalid.
+    const float* JointVelocity(size_t joint) const { return &m_velocity[3 * joint]; }
+    const float* JointAcceleration(size_t joint) const { return &m_acceleration[3 * joint]; }
+    float AngleVelocity(size_t angle) const { return m_velocity[3 * K4ABT_JOINT_COUNT + angle]; }
+    float AngleAcceleration(size_t angle) const { return m_acceleration[3 * K4ABT_JOINT_COUNT + angle]; }
+
+private:
+    // Recent records of one body. Slots of bodies that left are reused by new ones.
+    struct BodyHistory {
+        uint32_t BodyId = 0;
+        size_t Count = 0; // Valid samples, up to KINEMATICS_HISTORY
+        size_t Newest = 0; // Ring buffer index of the newest sample
+        uint64_t Timestamps[KINEMATICS_HISTORY] = {};
+        std::vector<float> Samples; // KINEMATICS_HISTORY samples of joint positions in meters followed by angles
+    };
+
+    // Find the history of a body, or a free one for it
+    BodyHistory& findHistory(uint32_t bodyId, uint64_t timestamp);
+
+    size_t m_valueCount = 3 * K4ABT_JOINT_COUNT;
+    std::vector<BodyHistory> m_histories;
+    std::vector<float> m_velocity;
+    std::vector<float> m_acceleration;
+};
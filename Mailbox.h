@@ -0,0 +1,51 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * Mailbox.h
+ * Contains a thread-safe single-slot mailbox that hands the latest item
+ * from a producer thread to a consumer thread without either one waiting.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <utility>
+
+// Items are exchanged instead of copied, so with a mailbox of pointers the producer, the slot and the consumer
+// each own one of three buffers and no buffer is written while the other thread is reading it
+template<typename T>
+class Mailbox {
+public:
+    explicit Mailbox(T initialItem) : m_item(std::move(initialItem)) {}
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    // Exchange the passed item with the one in the slot and mark it as new. Returns true if the replaced item
+    // was never taken, in which case it was skipped by the consumer.
+    bool Post(T& item) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(m_item, item);
+        bool replaced = m_hasNewItem;
+        m_hasNewItem = true;
+        return replaced;
+    }
+
+    // Exchange the passed item with the one in the slot if a new item was posted since the last call
+    bool Take(T& item) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_hasNewItem) {
+            return false;
+        }
+
+        std::swap(m_item, item);
+        m_hasNewItem = false;
+        return true;
+    }
+
+private:
+    T m_item;
+    bool m_hasNewItem = false;
+    std::mutex m_mutex;
+};
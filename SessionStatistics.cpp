@@ -0,0 +1,104 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SessionStatistics.cpp
+ * Contains the running statistics of every joint angle of each tracked
+ * body over a session, and their summary file.
+ */
+
+#include <cmath>
+
+#include "SessionStatistics.h"
+
+void AngleStatistics::Add(float angle, uint32_t frame) {
+    if(!IsJointAngleValid(angle)) {
+        Untracked++;
+        return;
+    }
+
+    Count++;
+    double delta = angle - Mean;
+    Mean += delta / Count;
+    SquaredDeviations += delta * (angle - Mean);
+
+    if(Count == 1 || angle < Min) {
+        Min = angle;
+        MinFrame = frame;
+    }
+    if(Count == 1 || angle > Max) {
+        Max = angle;
+        MaxFrame = frame;
+    }
+
+    // Angles are 0 to 180 degrees, with 180 itself in the last bin
+    int bin = (int) (angle / ANGLE_HISTOGRAM_BIN_WIDTH);
+    if(bin < 0) {
+        bin = 0;
+    }
+    else if(bin >= (int) ANGLE_HISTOGRAM_BINS) {
+        bin = ANGLE_HISTOGRAM_BINS - 1;
+    }
+    Histogram[bin]++;
+}
+
+double AngleStatistics::StandardDeviation() const {
+    return Count > 1 ? sqrt(SquaredDeviations / (Count - 1)) : 0.0;
+}
+
+void SessionStatistics::Reset(size_t angleCount) {
+    m_angleCount = angleCount;
+    m_bodies.clear();
+}
+
+BodyStatistics& SessionStatistics::findBody(uint32_t bodyId, uint32_t frame, double time) {
+    // Search from the newest body, since bodies in view are usually the last ones to appear
+    for(size_t i = m_bodies.size(); i > 0; i--) {
+        if(m_bodies[i - 1].BodyId == bodyId) {
+            return m_bodies[i - 1];
+        }
+    }
+
+    m_bodies.emplace_back();
+    BodyStatistics& body = m_bodies.back();
+    body.BodyId = bodyId;
+    body.FirstFrame = frame;
+    body.FirstTime = time;
+    body.Angles.resize(m_angleCount);
+    return body;
+}
+
+void SessionStatistics::Add(uint32_t bodyId, uint32_t frame, double time, const float* angles) {
+    BodyStatistics& body = findBody(bodyId, frame, time);
+    body.LastFrame = frame;
+    body.LastTime = time;
+    body.FrameCount++;
+
+    for(size_t i = 0; i < m_angleCount; i++) {
+        body.Angles[i].Add(angles[i], frame);
+    }
+}
+
+void SessionStatistics::Write(std::FILE* file, const JointAngleTable& angleTable) const {
+    for(const BodyStatistics& body : m_bodies) {
+        fprintf(file, "\nBody %u: %llu frames from frame %u to %u (%.3f s to %.3f s)\n", body.BodyId, (unsigned long long) body.FrameCount,
+                body.FirstFrame, body.LastFrame, body.FirstTime, body.LastTime);
+
+        for(size_t i = 0; i < body.Angles.size() && i < angleTable.Count(); i++) {
+            const AngleStatistics& angle = body.Angles[i];
+            if(angle.Count == 0) {
+                fprintf(file, "  %s: not tracked\n", angleTable[i].Name.c_str());
+                continue;
+            }
+
+            fprintf(file, "  %s: mean %.2f, std %.2f, min %.2f at frame %u, max %.2f at frame %u, range %.2f, %llu frames not tracked\n",
+                    angleTable[i].Name.c_str(), angle.Mean, angle.StandardDeviation(), angle.Min, angle.MinFrame, angle.Max, angle.MaxFrame,
+                    angle.Max - angle.Min, (unsigned long long) angle.Untracked);
+            fprintf(file, "    Frames per %g degrees:", ANGLE_HISTOGRAM_BIN_WIDTH);
+            for(size_t bin = 0; bin < ANGLE_HISTOGRAM_BINS; bin++) {
+                fprintf(file, " %u", angle.Histogram[bin]);
+            }
+            fprintf(file, "\n");
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SessionStatistics.h
+ * Contains the running statistics of every joint angle of each tracked
+ * body over a session, and their summary file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "JointAngles.h"
+
+const size_t ANGLE_HISTOGRAM_BINS = 18;
+const float ANGLE_HISTOGRAM_BIN_WIDTH = 10.0f; // Degrees, so the bins cover 0 to 180
+
+// Running statistics of one angle of one body. The mean and variance are updated with Welford's method,
+// which stays accurate over long sessions without keeping the angles.
+struct AngleStatistics {
+    uint64_t Count = 0; // Frames in which the angle was tracked
+    uint64_t Untracked = 0; // Frames in which the body was tracked but the angle was not
+    double Mean = 0.0;
+    double SquaredDeviations = 0.0; // Sum of squared differences from the mean
+    float Min = 0.0f;
+    float Max = 0.0f;
+    uint32_t MinFrame = 0;
+    uint32_t MaxFrame = 0;
+    uint32_t Histogram[ANGLE_HISTOGRAM_BINS] = {};
+
+    void Add(float angle, uint32_t frame);
+    // Sample standard deviation, or 0 with fewer than two angles
+    double StandardDeviation() const;
+};
+
+// Statistics of every angle of one body ID
+struct BodyStatistics {
+    uint32_t BodyId = 0;
+    uint32_t FirstFrame = 0;
+    uint32_t LastFrame = 0;
+    uint64_t FrameCount = 0;
+    double FirstTime = 0.0;
+    double LastTime = 0.0;
+    std::vector<AngleStatistics> Angles; // In the order of the angle table
+};
+
+// Statistics of each body ID seen in a session, updated as frames are processed so the summary costs nothing at the end.
+// Memory is only allocated when a new body ID appears.
+class SessionStatistics {
+public:
+    // Forget every body and prepare for angleCount angles per body
+    void Reset(size_t angleCount);
+
+    // Add the angles of a body in a frame, with invalid angles counted as untracked
+    void Add(uint32_t bodyId, uint32_t frame, double time, const float* angles);
+
+    size_t BodyCount() const { return m_bodies.size(); }
+    const BodyStatistics& Body(size_t index) const { return m_bodies[index]; }
+
+    // Write the statistics of every body in the order they were first seen
+    void Write(std::FILE* file, const JointAngleTable& angleTable) const;
+
+private:
+    BodyStatistics& findBody(uint32_t bodyId, uint32_t frame, double time);
+
+    size_t m_angleCount = 0;
+    std::vector<BodyStatistics> m_bodies;
+};
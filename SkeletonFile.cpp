@@ -0,0 +1,138 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * SkeletonFile.cpp
+ * Contains the binary skeleton file writer.
+ */
+
+#include <cstring>
+
+#include "SkeletonFile.h"
+
+size_t SkeletonCalibrationPadding(size_t calibrationSize) {
+    return (8 - calibrationSize % 8) % 8;
+}
+
+SkeletonFileWriter::~SkeletonFileWriter() {
+    Close();
+}
+
+bool SkeletonFileWriter::Open(const std::string& fileName, const k4a_calibration_t& calibration, const std::vector<uint8_t>& rawCalibration,
+                              const JointAngleTable& angles) {
+    std::string errorText;
+    if(!CanStoreSkeletonAngles(angles, errorText)) {
+        printf("%s\n", errorText.c_str());
+        return false;
+    }
+
+    if(fopen_s(&m_file, fileName.c_str(), "wb") != 0) {
+        m_file = NULL;
+        return false;
+    }
+
+    m_writeFailed = false;
+    m_chunk.clear();
+    m_chunk.reserve(SKELETON_CHUNK_RECORDS);
+
+    SkeletonFileHeader header = {};
+    memcpy(header.Magic, SKELETON_FILE_MAGIC, sizeof(header.Magic));
+    header.Version = SKELETON_FILE_VERSION;
+    header.HeaderSize = sizeof(SkeletonFileHeader);
+    header.RecordSize = sizeof(SkeletonRecord);
+    header.JointCount = K4ABT_JOINT_COUNT;
+    header.DepthMode = calibration.depth_mode;
+    header.ColorResolution = calibration.color_resolution;
+    header.CalibrationSize = (uint32_t) rawCalibration.size();
+    header.AngleCount = (uint32_t) angles.Count();
+
+    const uint8_t padding[8] = {};
+    writeBytes(&header, sizeof(header));
+    writeBytes(rawCalibration.data(), rawCalibration.size());
+    writeBytes(padding, SkeletonCalibrationPadding(rawCalibration.size()));
+
+    for(size_t i = 0; i < angles.Count(); i++) {
+        SkeletonAngleRecord angle = {};
+        for(int j = 0; j < 3; j++) {
+            angle.Joints[j] = angles[i].Joints[j];
+        }
+        memcpy(angle.Name, angles[i].Name.c_str(), angles[i].Name.size());
+        writeBytes(&angle, sizeof(angle));
+    }
+
+    return !m_writeFailed;
+}
+
+void SkeletonFileWriter::Close() {
+    if(m_file == NULL) {
+        return;
+    }
+
+    writeChunk();
+    fclose(m_file);
+    m_file = NULL;
+}
+
+void SkeletonFileWriter::Write(const SkeletonRecord& record) {
+    m_chunk.push_back(record);
+    if(m_chunk.size() >= SKELETON_CHUNK_RECORDS) {
+        writeChunk();
+    }
+}
+
+void SkeletonFileWriter::writeChunk() {
+    if(m_chunk.empty()) {
+        return;
+    }
+
+    SkeletonChunkHeader chunkHeader = {SKELETON_CHUNK_MAGIC, (uint32_t) m_chunk.size()};
+    writeBytes(&chunkHeader, sizeof(chunkHeader));
+    writeBytes(m_chunk.data(), m_chunk.size() * sizeof(SkeletonRecord));
+    m_chunk.clear();
+}
+
+void SkeletonFileWriter::writeBytes(const void* data, size_t size) {
+    if(size == 0 || m_writeFailed) {
+        return;
+    }
+
+    if(fwrite(data, 1, size, m_file) != size) {
+        printf("Error! Writing to skeleton file failed!\n");
+        m_writeFailed = true;
+    }
+}
+
+SkeletonRecord EmptySkeletonRecord(uint32_t frame, uint64_t deviceTimestampUsec, uint64_t systemTimestampNsec, double time) {
+    SkeletonRecord record = {};
+    record.Frame = frame;
+    record.BodyId = K4ABT_INVALID_BODY_ID;
+    record.DeviceTimestampUsec = deviceTimestampUsec;
+    record.SystemTimestampNsec = systemTimestampNsec;
+    record.Time = time;
+    SetSkeletonRecordAngles(record, NULL, 0);
+    return record;
+}
+
+bool CanStoreSkeletonAngles(const JointAngleTable& angles, std::string& errorText) {
+    if(angles.Count() > SKELETON_ANGLE_COUNT) {
+        errorText = "Binary skeleton files keep at most " + std::to_string(SKELETON_ANGLE_COUNT) + " angles, the angle table has " +
+                    std::to_string(angles.Count()) + ".";
+        return false;
+    }
+
+    for(size_t i = 0; i < angles.Count(); i++) {
+        if(angles[i].Name.size() >= SKELETON_ANGLE_NAME_SIZE) {
+            errorText = "Angle name " + angles[i].Name + " is too long for a binary skeleton file (at most " +
+                        std::to_string(SKELETON_ANGLE_NAME_SIZE - 1) + " characters).";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SetSkeletonRecordAngles(SkeletonRecord& record, const float* angles, size_t angleCount) {
+    for(size_t i = 0; i < SKELETON_ANGLE_COUNT; i++) {
+        record.Angles[i] = angles != NULL && i < angleCount ? angles[i] : JOINT_ANGLE_INVALID;
+    }
+}
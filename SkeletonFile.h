@@ -0,0 +1,114 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * SkeletonFile.h
+ * Contains the binary skeleton file format and its writer.
+ * 
+ * File layout:
+ *   SkeletonFileHeader
+ *   Raw calibration JSON (CalibrationSize bytes, zero-padded to a multiple of 8)
+ *   AngleCount SkeletonAngleRecords naming the Angles of every record
+ *   Chunks, each a SkeletonChunkHeader followed by RecordCount SkeletonRecords
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <k4abt.h>
+
+#include "JointAngles.h"
+
+const char SKELETON_FILE_MAGIC[8] = {'A', 'K', 'D', 'C', 'S', 'K', 'E', 'L'};
+const uint32_t SKELETON_FILE_VERSION = 3;
+const uint32_t SKELETON_FILE_MIN_VERSION = 2; // Version 2 files have no angle table
+const char SKELETON_FILE_EXTENSION[] = ".skel";
+const uint32_t SKELETON_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+const uint32_t SKELETON_CHUNK_RECORDS = 256; // Records buffered before a chunk is written
+const uint32_t SKELETON_ANGLE_COUNT = 4; // Angles kept in each record, which is also the most a binary file's angle table can have
+const uint32_t SKELETON_ANGLE_NAME_SIZE = 52; // Bytes of an angle name in the file, including the terminating zero
+
+struct SkeletonFileHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t HeaderSize; // sizeof(SkeletonFileHeader)
+    uint32_t RecordSize; // sizeof(SkeletonRecord)
+    uint32_t JointCount;
+    int32_t DepthMode; // k4a_depth_mode_t of the recording
+    int32_t ColorResolution; // k4a_color_resolution_t of the recording
+    uint32_t CalibrationSize; // Bytes of raw calibration JSON following the header
+    uint32_t AngleCount; // Angles of the angle table the records were written with, 0 in version 2 files
+};
+
+// One angle of the table the records were written with, so the file can be exported without the config file
+struct SkeletonAngleRecord {
+    uint32_t Joints[3]; // k4abt_joint_id_t of the first, vertex and last joint
+    char Name[SKELETON_ANGLE_NAME_SIZE];
+};
+
+struct SkeletonChunkHeader {
+    uint32_t Magic;
+    uint32_t RecordCount;
+};
+
+struct SkeletonJointRecord {
+    float Position[3]; // Millimeters, as returned by the body tracker
+    float Orientation[4]; // Quaternion in w, x, y, z order
+    uint32_t Confidence; // k4abt_joint_confidence_level_t
+};
+
+// One row of output: a single body in a single frame
+struct SkeletonRecord {
+    uint32_t Frame;
+    uint32_t BodyId; // K4ABT_INVALID_BODY_ID for a frame without body data
+    uint64_t DeviceTimestampUsec; // Depth image device timestamp
+    uint64_t SystemTimestampNsec; // Depth image system timestamp, 0 in recordings
+    double Time; // Seconds since the first frame, from device timestamps
+    float Angles[SKELETON_ANGLE_COUNT]; // Angles of the angle table in degrees, JOINT_ANGLE_INVALID if not measured or past the end of the table
+    SkeletonJointRecord Joints[K4ABT_JOINT_COUNT];
+};
+
+static_assert(sizeof(SkeletonFileHeader) == 40, "SkeletonFileHeader layout changed");
+static_assert(sizeof(SkeletonAngleRecord) == 64, "SkeletonAngleRecord layout changed");
+static_assert(sizeof(SkeletonJointRecord) == 32, "SkeletonJointRecord layout changed");
+static_assert(sizeof(SkeletonRecord) == 48 + 32 * K4ABT_JOINT_COUNT, "SkeletonRecord layout changed");
+
+// Write skeleton records to a binary skeleton file
+class SkeletonFileWriter {
+public:
+    SkeletonFileWriter() = default;
+    ~SkeletonFileWriter();
+
+    SkeletonFileWriter(const SkeletonFileWriter&) = delete;
+    SkeletonFileWriter& operator=(const SkeletonFileWriter&) = delete;
+
+    // Create the file and write the header, calibration and angle table. The table has to fit, see CanStoreSkeletonAngles.
+    bool Open(const std::string& fileName, const k4a_calibration_t& calibration, const std::vector<uint8_t>& rawCalibration,
+              const JointAngleTable& angles);
+    bool IsOpen() const { return m_file != NULL; }
+    // Write the last partial chunk and close the file
+    void Close();
+
+    void Write(const SkeletonRecord& record);
+
+private:
+    void writeChunk();
+    void writeBytes(const void* data, size_t size);
+
+    std::FILE* m_file = NULL;
+    bool m_writeFailed = false;
+    std::vector<SkeletonRecord> m_chunk;
+};
+
+// Number of zero bytes that keep records aligned after the raw calibration
+size_t SkeletonCalibrationPadding(size_t calibrationSize);
+// Fill a record for a frame without body data
+SkeletonRecord EmptySkeletonRecord(uint32_t frame, uint64_t deviceTimestampUsec, uint64_t systemTimestampNsec, double time);
+// Check if every angle of a table can be kept in the records and angle table of a binary file
+bool CanStoreSkeletonAngles(const JointAngleTable& angles, std::string& errorText);
+// Copy the angles of a table to a record, leaving the other slots JOINT_ANGLE_INVALID. Angles can be NULL if none were calculated.
+void SetSkeletonRecordAngles(SkeletonRecord& record, const float* angles, size_t angleCount);
@@ -0,0 +1,268 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SkeletonOutput.cpp
+ * Contains the CSV row layout and the CSV and binary skeleton output.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "SkeletonOutput.h"
+
+// Joint names of the CSV columns, in k4abt_joint_id_t order
+const char* const SKELETON_CSV_JOINT_NAMES[K4ABT_JOINT_COUNT] = {
+    "Pelvis", "SpineNavel", "SpineChest", "Neck", "ClavicleLeft", "ShoulderLeft", "ElbowLeft", "WristLeft",
+    "HandLeft", "HandTipLeft", "ThumbLeft", "ClavicleRight", "ShoulderRight", "ElbowRight", "WristRight", "HandRight",
+    "HandTipRight", "ThumbRight", "HipLeft", "KneeLeft", "AnkleLeft", "FootLeft", "HipRight", "KneeRight",
+    "AnkleRight", "FootRight", "Head", "Nose", "EyeLeft", "EarLeft", "EyeRight", "EarRight"
+};
+
+// Write a value, or leave it empty if it is not a number
+void writeOptionalValue(CsvWriter& csv, float value) {
+    if(!std::isnan(value)) {
+        csv << value;
+    }
+}
+
+// Write the position of a joint, its distance from the sensor and its confidence as one cell
+void writeJointPosition(CsvWriter& csv, const SkeletonJointRecord& joint) {
+    // Convert joint position values from millimeters to meters
+    float x = joint.Position[0] / 1000;
+    float y = joint.Position[1] / 1000;
+    float z = joint.Position[2] / 1000;
+
+    float distFromSensor = sqrtf(x * x + y * y + z * z);
+
+    csv << "\"<" << x << ", " << y << ", " << z << ">, " << distFromSensor
+        << ":" << joint.Confidence << "\",";
+}
+
+bool SkeletonCsvOutput::Open(const std::string& fileName, const SkeletonCsvOptions& options, SessionStatistics* statistics) {
+    m_options = options;
+    m_statistics = statistics;
+    m_rawAngleStart = 0;
+    m_rawAngleCount = 0;
+    if(m_options.Filter.Type == JointFilterType::None) {
+        m_options.Raw = false;
+    }
+
+    m_angles.SetTable(m_options.Angles);
+    m_rawAngles.SetTable(m_options.Angles);
+    m_filter.Reset(m_options.Filter);
+    m_kinematics.Reset(m_options.Angles.Count());
+
+    if(!m_csv.Open(fileName)) {
+        return false;
+    }
+
+    writeHeader();
+    return true;
+}
+
+void SkeletonCsvOutput::Write(const SkeletonRecord& record, const float* angles) {
+    if(m_options.Filter.Type == JointFilterType::None) {
+        if(angles == NULL && record.BodyId != K4ABT_INVALID_BODY_ID) {
+            m_angles.Compute(&record, 1);
+            angles = m_angles.Angles(0);
+        }
+        writeRow(record, angles, record, angles);
+        return;
+    }
+
+    if(m_options.Raw && record.BodyId != K4ABT_INVALID_BODY_ID) {
+        queueRawAngles(record, angles);
+    }
+    m_filter.Add(record);
+    while(m_filter.Take(m_filteredRecord, m_rawRecord)) {
+        writeFiltered();
+    }
+}
+
+void SkeletonCsvOutput::queueRawAngles(const SkeletonRecord& record, const float* angles) {
+    if(angles == NULL) {
+        m_rawAngles.Compute(&record, 1);
+        angles = m_rawAngles.Angles(0);
+    }
+
+    // Grow the ring buffer in order when it is full. Angle tables are never empty.
+    size_t angleCount = m_options.Angles.Count();
+    size_t capacity = m_rawAngleQueue.size() / angleCount;
+    if(m_rawAngleCount == capacity) {
+        size_t newCapacity = std::max<size_t>(16, 2 * capacity);
+        std::vector<float> queue(newCapacity * angleCount);
+        for(size_t i = 0; i < m_rawAngleCount; i++) {
+            memcpy(&queue[i * angleCount], &m_rawAngleQueue[(m_rawAngleStart + i) % capacity * angleCount], angleCount * sizeof(float));
+        }
+        m_rawAngleQueue.swap(queue);
+        m_rawAngleStart = 0;
+        capacity = newCapacity;
+    }
+
+    memcpy(&m_rawAngleQueue[(m_rawAngleStart + m_rawAngleCount) % capacity * angleCount], angles, angleCount * sizeof(float));
+    m_rawAngleCount++;
+}
+
+const float* SkeletonCsvOutput::takeRawAngles() {
+    // The filter passes records on in the order they were added, so the oldest angles belong to the record that came out
+    size_t angleCount = m_options.Angles.Count();
+    const float* angles = &m_rawAngleQueue[m_rawAngleStart * angleCount];
+    m_rawAngleStart = (m_rawAngleStart + 1) % (m_rawAngleQueue.size() / angleCount);
+    m_rawAngleCount--;
+    return angles;
+}
+
+void SkeletonCsvOutput::writeFiltered() {
+    if(m_filteredRecord.BodyId == K4ABT_INVALID_BODY_ID) {
+        writeRow(m_filteredRecord, NULL, m_rawRecord, NULL);
+        return;
+    }
+
+    // Angles of the filtered joints, and of the raw joints only if they are written
+    m_angles.Compute(&m_filteredRecord, 1);
+    const float* rawAngles = m_options.Raw ? takeRawAngles() : NULL;
+    writeRow(m_filteredRecord, m_angles.Angles(0), m_rawRecord, rawAngles);
+}
+
+void SkeletonCsvOutput::Close() {
+    if(m_csv.IsOpen() && m_options.Filter.Type != JointFilterType::None) {
+        m_filter.Flush();
+        while(m_filter.Take(m_filteredRecord, m_rawRecord)) {
+            writeFiltered();
+        }
+    }
+    m_csv.Close();
+}
+
+void SkeletonCsvOutput::writeHeader() {
+    const JointAngleTable& angleTable = m_options.Angles;
+    m_csv << "Frame,Time,ID,";
+    for(size_t i = 0; i < angleTable.Count(); i++) {
+        m_csv << angleTable[i].Name << " Angle,";
+    }
+    for(int i = 0; i < K4ABT_JOINT_COUNT; i++) {
+        m_csv << (i > 0 ? "," : "") << SKELETON_CSV_JOINT_NAMES[i] << " Pos";
+    }
+
+    if(m_options.Raw) {
+        for(size_t i = 0; i < angleTable.Count(); i++) {
+            m_csv << "," << angleTable[i].Name << " Raw Angle";
+        }
+        for(int i = 0; i < K4ABT_JOINT_COUNT; i++) {
+            m_csv << "," << SKELETON_CSV_JOINT_NAMES[i] << " Raw Pos";
+        }
+    }
+
+    if(m_options.Kinematics) {
+        for(size_t i = 0; i < angleTable.Count(); i++) {
+            m_csv << "," << angleTable[i].Name << " Angular Velocity," << angleTable[i].Name << " Angular Acceleration";
+        }
+        for(int i = 0; i < K4ABT_JOINT_COUNT; i++) {
+            m_csv << "," << SKELETON_CSV_JOINT_NAMES[i] << " Vel," << SKELETON_CSV_JOINT_NAMES[i] << " Acc";
+        }
+    }
+
+    if(m_options.Timestamps) {
+        m_csv << ",Device Timestamp (us),System Timestamp (ns)";
+    }
+
+    m_csv.EndRow();
+}
+
+void SkeletonCsvOutput::writeRow(const SkeletonRecord& record, const float* angles, const SkeletonRecord& raw, const float* rawAngles) {
+    // Frames without body data only have a frame number
+    if(record.BodyId == K4ABT_INVALID_BODY_ID) {
+        m_csv << record.Frame << ",,";
+        m_csv.EndRow();
+        return;
+    }
+
+    // Statistics describe the angles in the file, in the frames of their rows
+    size_t angleCount = m_options.Angles.Count();
+    if(m_statistics != NULL) {
+        m_statistics->Add(record.BodyId, record.Frame, record.Time, angles);
+    }
+
+    m_csv << record.Frame << "," << record.Time << "," << record.BodyId << ",";
+    // Angles that cannot be measured are left empty
+    for(size_t i = 0; i < angleCount; i++) {
+        writeOptionalValue(m_csv, angles[i]);
+        m_csv << ",";
+    }
+
+    // Write joint positions and distance from sensor
+    for(int i = 0; i < K4ABT_JOINT_COUNT; ++i) {
+        writeJointPosition(m_csv, record.Joints[i]);
+    }
+
+    // Write the angles and joints as the tracker returned them
+    if(m_options.Raw) {
+        for(size_t i = 0; i < angleCount; i++) {
+            writeOptionalValue(m_csv, rawAngles[i]);
+            m_csv << ",";
+        }
+        for(int i = 0; i < K4ABT_JOINT_COUNT; ++i) {
+            writeJointPosition(m_csv, raw.Joints[i]);
+        }
+    }
+
+    // Write angle derivatives, then joint velocity and acceleration vectors and their magnitudes.
+    // Values are left empty until the body has enough history.
+    if(m_options.Kinematics) {
+        m_kinematics.Update(record, angles);
+        for(size_t i = 0; i < angleCount; i++) {
+            writeOptionalValue(m_csv, m_kinematics.AngleVelocity(i));
+            m_csv << ",";
+            writeOptionalValue(m_csv, m_kinematics.AngleAcceleration(i));
+            m_csv << ",";
+        }
+        for(int i = 0; i < K4ABT_JOINT_COUNT; ++i) {
+            const float* derivatives[2] = {m_kinematics.JointVelocity(i), m_kinematics.JointAcceleration(i)};
+            for(const float* derivative : derivatives) {
+                if(!std::isnan(derivative[0])) {
+                    float magnitude = sqrtf(derivative[0] * derivative[0] + derivative[1] * derivative[1] + derivative[2] * derivative[2]);
+                    m_csv << "\"<" << derivative[0] << ", " << derivative[1] << ", " << derivative[2] << ">, " << magnitude << "\"";
+                }
+                m_csv << ",";
+            }
+        }
+    }
+
+    // Joint columns already end with a separator
+    if(m_options.Timestamps) {
+        m_csv << (unsigned long long) record.DeviceTimestampUsec << "," << (unsigned long long) record.SystemTimestampNsec;
+    }
+
+    m_csv.EndRow();
+}
+
+bool SkeletonOutput::Open(const std::string& fileName, bool binary, const SkeletonCsvOptions& csvOptions,
+                          const k4a_calibration_t& calibration, const std::vector<uint8_t>& rawCalibration, SessionStatistics* statistics) {
+    m_binary = binary;
+    m_statistics = statistics;
+    if(m_binary) {
+        return m_skeletons.Open(fileName, calibration, rawCalibration, csvOptions.Angles);
+    }
+
+    return m_csv.Open(fileName, csvOptions, statistics);
+}
+
+void SkeletonOutput::Write(const SkeletonRecord& record, const float* angles) {
+    // Binary files keep raw records; filters and derivatives are applied when they are exported
+    if(m_binary) {
+        m_skeletons.Write(record);
+        if(m_statistics != NULL && record.BodyId != K4ABT_INVALID_BODY_ID) {
+            m_statistics->Add(record.BodyId, record.Frame, record.Time, angles);
+        }
+    }
+    else {
+        m_csv.Write(record, angles);
+    }
+}
+
+void SkeletonOutput::Close() {
+    m_skeletons.Close();
+    m_csv.Close();
+}
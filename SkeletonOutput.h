@@ -0,0 +1,94 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SkeletonOutput.h
+ * Contains the output of skeleton records: the CSV layout with its angle,
+ * filter and kinematics columns, and the choice between CSV and binary
+ * skeleton files.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <k4abt.h>
+
+#include "CsvWriter.h"
+#include "JointAngles.h"
+#include "JointFilters.h"
+#include "Kinematics.h"
+#include "SessionStatistics.h"
+#include "SkeletonFile.h"
+
+// Columns of CSV output and the processing of records before they are written
+struct SkeletonCsvOptions {
+    JointAngleTable Angles; // An angle column for each angle of the table
+    JointFilterSettings Filter; // Joints are filtered before angles and derivatives are calculated
+    bool Raw = false; // Add unfiltered angle and joint columns after the filtered ones when a filter is used
+    bool Kinematics = false; // Add angle and joint derivative columns
+    bool Timestamps = false; // Add raw device and system timestamp columns at the end
+};
+
+// Write skeleton records as CSV rows
+class SkeletonCsvOutput {
+public:
+    // Create the file and write the column names. The angles of every body row written are added to statistics if it is not NULL.
+    bool Open(const std::string& fileName, const SkeletonCsvOptions& options, SessionStatistics* statistics);
+    // Check if Write uses the angles of the records as they are passed, or calculates its own from filtered joints
+    bool UsesRecordAngles() const { return m_options.Filter.Type == JointFilterType::None || m_options.Raw; }
+    // Write a record with every angle of the table. Angles are calculated from the joints if they are NULL,
+    // and from the filtered joints if a filter is used. With a Savitzky-Golay lookahead, rows are written
+    // once the records of the following frames are in.
+    void Write(const SkeletonRecord& record, const float* angles);
+    // Write the rows still waiting for the filter and close the file
+    void Close();
+
+private:
+    void writeHeader();
+    // Write the filtered and raw records once they come out of the filter
+    void writeFiltered();
+    // Write a record and its angles as one row, with the raw record and angles if raw columns are written
+    void writeRow(const SkeletonRecord& record, const float* angles, const SkeletonRecord& raw, const float* rawAngles);
+    // Keep the raw angles of a record in the filter until it comes out, so they are only calculated once
+    void queueRawAngles(const SkeletonRecord& record, const float* angles);
+    const float* takeRawAngles();
+
+    SkeletonCsvOptions m_options;
+    CsvWriter m_csv;
+    JointAngleCalculator m_angles;
+    JointAngleCalculator m_rawAngles;
+    JointFilter m_filter;
+    KinematicsTracker m_kinematics;
+    SessionStatistics* m_statistics = NULL;
+
+    // Ring buffer of the raw angles of body records in the filter, in the order they were added
+    std::vector<float> m_rawAngleQueue;
+    size_t m_rawAngleStart = 0;
+    size_t m_rawAngleCount = 0;
+
+    SkeletonRecord m_filteredRecord = {};
+    SkeletonRecord m_rawRecord = {};
+};
+
+// Destination for skeleton records, written as CSV or in the binary skeleton format
+class SkeletonOutput {
+public:
+    // Binary files keep the records as the tracker returned them; CSV options apply to CSV output and to its later export.
+    // The angles of every body record written are added to statistics if it is not NULL, so they describe the file.
+    bool Open(const std::string& fileName, bool binary, const SkeletonCsvOptions& csvOptions,
+              const k4a_calibration_t& calibration, const std::vector<uint8_t>& rawCalibration, SessionStatistics* statistics);
+    // Check if Write needs the angles of the records as they are passed, or can be passed NULL and calculate its own
+    bool UsesRecordAngles() const { return m_binary || m_csv.UsesRecordAngles(); }
+    // Write a record with every angle of the table. Angles can be NULL for a frame without body data,
+    // and for body records if UsesRecordAngles is false.
+    void Write(const SkeletonRecord& record, const float* angles);
+    void Close();
+
+private:
+    bool m_binary = false;
+    SessionStatistics* m_statistics = NULL;
+    SkeletonCsvOutput m_csv;
+    SkeletonFileWriter m_skeletons;
+};
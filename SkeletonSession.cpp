@@ -0,0 +1,343 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * SkeletonSession.cpp
+ * Contains the memory-mapped skeleton file reader and its index.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "SkeletonSession.h"
+
+const char SKELETON_INDEX_MAGIC[8] = {'A', 'K', 'D', 'C', 'S', 'I', 'D', 'X'};
+const uint32_t SKELETON_INDEX_VERSION = 1;
+const char SKELETON_INDEX_EXTENSION[] = ".idx";
+
+// Header of the cached index file. The index is rebuilt if the session file no longer matches it.
+struct SkeletonIndexHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t EntrySize;
+    uint64_t SourceSize;
+    uint64_t SourceWriteTime;
+    uint64_t RecordCount;
+};
+
+const SkeletonRecord& SkeletonTrack::Iterator::operator*() const {
+    return m_session->Record(*m_position);
+}
+
+SkeletonTrack::Iterator SkeletonTrack::FindFrame(uint32_t frame) const {
+    const uint32_t* position = std::lower_bound(m_first, m_last, frame, [this](uint32_t index, uint32_t value) {
+        return m_session->Record(index).Frame < value;
+    });
+    return Iterator(m_session, position);
+}
+
+SkeletonSession::~SkeletonSession() {
+    Close();
+}
+
+bool SkeletonSession::Open(const std::string& fileName) {
+    Close();
+
+    m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    if(m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    FILETIME writeTime;
+    if(!GetFileSizeEx(m_file, &fileSize) || !GetFileTime(m_file, NULL, NULL, &writeTime) ||
+       fileSize.QuadPart < (LONGLONG) sizeof(SkeletonFileHeader)) {
+        Close();
+        return false;
+    }
+    m_size = (uint64_t) fileSize.QuadPart;
+    m_writeTime = ((uint64_t) writeTime.dwHighDateTime << 32) | writeTime.dwLowDateTime;
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(m_mapping == NULL) {
+        Close();
+        return false;
+    }
+
+    m_data = (const uint8_t*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if(m_data == NULL) {
+        Close();
+        return false;
+    }
+
+    // Check that the file was written with the same record layout
+    m_header = (const SkeletonFileHeader*) m_data;
+    if(memcmp(m_header->Magic, SKELETON_FILE_MAGIC, sizeof(m_header->Magic)) != 0 ||
+       m_header->Version < SKELETON_FILE_MIN_VERSION || m_header->Version > SKELETON_FILE_VERSION ||
+       m_header->HeaderSize != sizeof(SkeletonFileHeader) ||
+       m_header->RecordSize != sizeof(SkeletonRecord) ||
+       m_header->JointCount != K4ABT_JOINT_COUNT ||
+       sizeof(SkeletonFileHeader) + m_header->CalibrationSize > m_size) {
+        Close();
+        return false;
+    }
+
+    // Version 2 used the angle count as a reserved field, which was always 0
+    m_angleOffset = sizeof(SkeletonFileHeader) + m_header->CalibrationSize + SkeletonCalibrationPadding(m_header->CalibrationSize);
+    if(m_header->AngleCount > SKELETON_ANGLE_COUNT || m_angleOffset + m_header->AngleCount * sizeof(SkeletonAngleRecord) > m_size) {
+        Close();
+        return false;
+    }
+
+    const SkeletonAngleRecord* angleRecords = (const SkeletonAngleRecord*) (m_data + m_angleOffset);
+    for(uint32_t i = 0; i < m_header->AngleCount; i++) {
+        for(uint32_t joint : angleRecords[i].Joints) {
+            if(joint >= K4ABT_JOINT_COUNT) {
+                Close();
+                return false;
+            }
+        }
+    }
+
+    // Use the cached index if it belongs to this version of the file, otherwise build it and cache it
+    std::string indexFileName = fileName + SKELETON_INDEX_EXTENSION;
+    if(!loadIndex(indexFileName)) {
+        buildIndex();
+        saveIndex(indexFileName);
+    }
+
+    return true;
+}
+
+void SkeletonSession::Close() {
+    if(m_data != NULL) {
+        UnmapViewOfFile(m_data);
+        m_data = NULL;
+    }
+
+    if(m_mapping != NULL) {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+
+    if(m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+
+    m_header = NULL;
+    m_size = 0;
+    m_angleOffset = 0;
+    m_entries.clear();
+    m_timeOrder.clear();
+    m_bodyOrder.clear();
+}
+
+JointAngleTable SkeletonSession::AngleTable() const {
+    JointAngleTable angles;
+    angles.Clear();
+
+    const SkeletonAngleRecord* angleRecords = (const SkeletonAngleRecord*) (m_data + m_angleOffset);
+    for(uint32_t i = 0; i < m_header->AngleCount; i++) {
+        const SkeletonAngleRecord& angleRecord = angleRecords[i];
+        JointAngleDefinition definition;
+        definition.Name.assign(angleRecord.Name, strnlen(angleRecord.Name, sizeof(angleRecord.Name)));
+        for(int j = 0; j < 3; j++) {
+            definition.Joints[j] = (k4abt_joint_id_t) angleRecord.Joints[j];
+        }
+        angles.Add(definition);
+    }
+
+    return angles;
+}
+
+const SkeletonRecord& SkeletonSession::Record(size_t index) const {
+    return *(const SkeletonRecord*) (m_data + m_entries[index].Offset);
+}
+
+size_t SkeletonSession::FindFrame(uint32_t frame) const {
+    auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), frame, [](const IndexEntry& e, uint32_t value) {
+        return e.Frame < value;
+    });
+    return entry - m_entries.begin();
+}
+
+size_t SkeletonSession::FindDeviceTimestamp(uint64_t deviceTimestampUsec) const {
+    auto position = std::lower_bound(m_timeOrder.begin(), m_timeOrder.end(), deviceTimestampUsec, [this](uint32_t index, uint64_t value) {
+        return m_entries[index].DeviceTimestampUsec < value;
+    });
+    return position == m_timeOrder.end() ? RecordCount() : *position;
+}
+
+SkeletonTrack SkeletonSession::Track(uint32_t bodyId) const {
+    const uint32_t* first = std::lower_bound(m_bodyOrder.data(), m_bodyOrder.data() + m_bodyOrder.size(), bodyId, [this](uint32_t index, uint32_t value) {
+        return m_entries[index].BodyId < value;
+    });
+    const uint32_t* last = std::upper_bound(first, m_bodyOrder.data() + m_bodyOrder.size(), bodyId, [this](uint32_t value, uint32_t index) {
+        return value < m_entries[index].BodyId;
+    });
+    return SkeletonTrack(this, first, last);
+}
+
+std::vector<uint32_t> SkeletonSession::BodyIds() const {
+    std::vector<uint32_t> bodyIds;
+    for(uint32_t index : m_bodyOrder) {
+        uint32_t bodyId = m_entries[index].BodyId;
+        if(bodyId != K4ABT_INVALID_BODY_ID && (bodyIds.empty() || bodyIds.back() != bodyId)) {
+            bodyIds.push_back(bodyId);
+        }
+    }
+    return bodyIds;
+}
+
+// Walk the chunks of the mapped file and sort the records by each key
+void SkeletonSession::buildIndex() {
+    uint64_t offset = m_angleOffset + m_header->AngleCount * sizeof(SkeletonAngleRecord);
+
+    // Stop at the end of the file or at a chunk that was not completely written
+    while(offset + sizeof(SkeletonChunkHeader) <= m_size) {
+        const SkeletonChunkHeader* chunkHeader = (const SkeletonChunkHeader*) (m_data + offset);
+        if(chunkHeader->Magic != SKELETON_CHUNK_MAGIC) {
+            break;
+        }
+        offset += sizeof(SkeletonChunkHeader);
+
+        uint64_t recordCount = std::min<uint64_t>(chunkHeader->RecordCount, (m_size - offset) / sizeof(SkeletonRecord));
+        for(uint64_t i = 0; i < recordCount; ++i) {
+            const SkeletonRecord* record = (const SkeletonRecord*) (m_data + offset);
+            m_entries.push_back({offset, record->DeviceTimestampUsec, record->Frame, record->BodyId});
+            offset += sizeof(SkeletonRecord);
+        }
+
+        if(recordCount < chunkHeader->RecordCount) {
+            break;
+        }
+    }
+
+    // Records are written in frame order, so this only reorders files that were put together by hand
+    std::stable_sort(m_entries.begin(), m_entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.Frame < b.Frame;
+    });
+
+    m_timeOrder.resize(m_entries.size());
+    m_bodyOrder.resize(m_entries.size());
+    for(uint32_t i = 0; i < (uint32_t) m_entries.size(); ++i) {
+        m_timeOrder[i] = i;
+        m_bodyOrder[i] = i;
+    }
+
+    std::stable_sort(m_timeOrder.begin(), m_timeOrder.end(), [this](uint32_t a, uint32_t b) {
+        return m_entries[a].DeviceTimestampUsec < m_entries[b].DeviceTimestampUsec;
+    });
+    std::stable_sort(m_bodyOrder.begin(), m_bodyOrder.end(), [this](uint32_t a, uint32_t b) {
+        return m_entries[a].BodyId < m_entries[b].BodyId;
+    });
+}
+
+bool SkeletonSession::loadIndex(const std::string& indexFileName) {
+    std::FILE* indexFile = NULL;
+    if(fopen_s(&indexFile, indexFileName.c_str(), "rb") != 0) {
+        return false;
+    }
+
+    SkeletonIndexHeader header;
+    bool loaded = fread(&header, sizeof(header), 1, indexFile) == 1 &&
+                  memcmp(header.Magic, SKELETON_INDEX_MAGIC, sizeof(header.Magic)) == 0 &&
+                  header.Version == SKELETON_INDEX_VERSION &&
+                  header.EntrySize == sizeof(IndexEntry) &&
+                  header.SourceSize == m_size &&
+                  header.SourceWriteTime == m_writeTime &&
+                  header.RecordCount <= m_size / sizeof(SkeletonRecord);
+
+    if(loaded) {
+        size_t count = (size_t) header.RecordCount;
+        m_entries.resize(count);
+        m_timeOrder.resize(count);
+        m_bodyOrder.resize(count);
+        loaded = fread(m_entries.data(), sizeof(IndexEntry), count, indexFile) == count &&
+                 fread(m_timeOrder.data(), sizeof(uint32_t), count, indexFile) == count &&
+                 fread(m_bodyOrder.data(), sizeof(uint32_t), count, indexFile) == count;
+    }
+
+    fclose(indexFile);
+
+    if(!loaded) {
+        m_entries.clear();
+        m_timeOrder.clear();
+        m_bodyOrder.clear();
+    }
+
+    return loaded;
+}
+
+// Write the index next to the session. Failing to write it only means it is built again next time.
+void SkeletonSession::saveIndex(const std::string& indexFileName) const {
+    std::FILE* indexFile = NULL;
+    if(fopen_s(&indexFile, indexFileName.c_str(), "wb") != 0) {
+        return;
+    }
+
+    SkeletonIndexHeader header = {};
+    memcpy(header.Magic, SKELETON_INDEX_MAGIC, sizeof(header.Magic));
+    header.Version = SKELETON_INDEX_VERSION;
+    header.EntrySize = sizeof(IndexEntry);
+    header.SourceSize = m_size;
+    header.SourceWriteTime = m_writeTime;
+    header.RecordCount = m_entries.size();
+
+    size_t count = m_entries.size();
+    bool saved = fwrite(&header, sizeof(header), 1, indexFile) == 1 &&
+                 fwrite(m_entries.data(), sizeof(IndexEntry), count, indexFile) == count &&
+                 fwrite(m_timeOrder.data(), sizeof(uint32_t), count, indexFile) == count &&
+                 fwrite(m_bodyOrder.data(), sizeof(uint32_t), count, indexFile) == count;
+
+    fclose(indexFile);
+
+    if(!saved) {
+        remove(indexFileName.c_str());
+    }
+}
+
+bool ExportSkeletonFile(const std::string& inputFileName, const std::string& outputFileName, uint32_t firstFrame, uint32_t lastFrame, uint32_t bodyId,
+                        const SkeletonCsvOptions& csvOptions, bool storedAngles) {
+    SkeletonSession session;
+    if(!session.Open(inputFileName)) {
+        printf("Open skeleton file %s failed.\n", inputFileName.c_str());
+        return false;
+    }
+
+    // Name the angle columns after the table the records were written with. Version 2 files did not store it.
+    SkeletonCsvOptions options = csvOptions;
+    storedAngles = storedAngles && session.Header().AngleCount > 0;
+    if(storedAngles) {
+        options.Angles = session.AngleTable();
+    }
+
+    SkeletonCsvOutput csv;
+    if(!csv.Open(outputFileName, options, NULL)) {
+        printf("Open file %s failed.\n", outputFileName.c_str());
+        return false;
+    }
+
+    // Write the stored angles, or calculate the passed table's angles from the joints.
+    // Seek to the first frame with the index instead of scanning the file
+    size_t recordCount = 0;
+    if(bodyId != K4ABT_INVALID_BODY_ID) {
+        SkeletonTrack track = session.Track(bodyId);
+        for(SkeletonTrack::Iterator record = track.FindFrame(firstFrame); record != track.end() && (*record).Frame <= lastFrame; ++record) {
+            csv.Write(*record, storedAngles ? (*record).Angles : NULL);
+            recordCount++;
+        }
+    }
+    else {
+        for(size_t i = session.FindFrame(firstFrame); i < session.RecordCount() && session.Record(i).Frame <= lastFrame; ++i) {
+            const SkeletonRecord& record = session.Record(i);
+            csv.Write(record, storedAngles && record.BodyId != K4ABT_INVALID_BODY_ID ? record.Angles : NULL);
+            recordCount++;
+        }
+    }
+
+    csv.Close();
+    printf("Exported %zu rows from %s to %s.\n", recordCount, inputFileName.c_str(), outputFileName.c_str());
+    return true;
+}
@@ -0,0 +1,118 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * SkeletonSession.h
+ * Contains a random-access reader for binary skeleton files. The file is
+ * memory-mapped and indexed by frame, device timestamp and body ID. The
+ * index is cached in a file next to the session so it is only built once.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include "SkeletonFile.h"
+#include "SkeletonOutput.h"
+
+class SkeletonSession;
+
+// Records of a single body in frame order
+class SkeletonTrack {
+public:
+    class Iterator {
+    public:
+        Iterator(const SkeletonSession* session, const uint32_t* position) : m_session(session), m_position(position) {}
+
+        const SkeletonRecord& operator*() const;
+        Iterator& operator++() { ++m_position; return *this; }
+        bool operator!=(const Iterator& other) const { return m_position != other.m_position; }
+
+    private:
+        const SkeletonSession* m_session;
+        const uint32_t* m_position;
+    };
+
+    SkeletonTrack(const SkeletonSession* session, const uint32_t* first, const uint32_t* last) : m_session(session), m_first(first), m_last(last) {}
+
+    Iterator begin() const { return Iterator(m_session, m_first); }
+    Iterator end() const { return Iterator(m_session, m_last); }
+    size_t size() const { return m_last - m_first; }
+    bool empty() const { return m_first == m_last; }
+
+    // Iterator to the first record of the track at or after the passed frame
+    Iterator FindFrame(uint32_t frame) const;
+
+private:
+    const SkeletonSession* m_session;
+    const uint32_t* m_first;
+    const uint32_t* m_last;
+};
+
+class SkeletonSession {
+public:
+    SkeletonSession() = default;
+    ~SkeletonSession();
+
+    SkeletonSession(const SkeletonSession&) = delete;
+    SkeletonSession& operator=(const SkeletonSession&) = delete;
+
+    // Map the file and load its index, building and caching the index if needed.
+    // Returns false if the file cannot be mapped or is not a supported skeleton file.
+    bool Open(const std::string& fileName);
+    void Close();
+
+    const SkeletonFileHeader& Header() const { return *m_header; }
+    const uint8_t* RawCalibration() const { return m_data + sizeof(SkeletonFileHeader); }
+    // Angle table the records were written with, empty for version 2 files
+    JointAngleTable AngleTable() const;
+
+    // Records are numbered in frame order
+    size_t RecordCount() const { return m_entries.size(); }
+    const SkeletonRecord& Record(size_t index) const;
+
+    // Index of the first record at or after the passed frame or device timestamp, or RecordCount() if there is none
+    size_t FindFrame(uint32_t frame) const;
+    size_t FindDeviceTimestamp(uint64_t deviceTimestampUsec) const;
+
+    // Records of the passed body. The track is empty if the body never appears.
+    SkeletonTrack Track(uint32_t bodyId) const;
+    // Every body ID in the session in increasing order
+    std::vector<uint32_t> BodyIds() const;
+
+private:
+    // Location and keys of one record, in frame order
+    struct IndexEntry {
+        uint64_t Offset;
+        uint64_t DeviceTimestampUsec;
+        uint32_t Frame;
+        uint32_t BodyId;
+    };
+
+    void buildIndex();
+    bool loadIndex(const std::string& indexFileName);
+    void saveIndex(const std::string& indexFileName) const;
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+    const uint8_t* m_data = NULL;
+    uint64_t m_size = 0;
+    uint64_t m_writeTime = 0;
+    uint64_t m_angleOffset = 0; // Start of the angle table, after the padded calibration
+    const SkeletonFileHeader* m_header = NULL;
+
+    std::vector<IndexEntry> m_entries;
+    std::vector<uint32_t> m_timeOrder; // Record numbers sorted by device timestamp
+    std::vector<uint32_t> m_bodyOrder; // Record numbers sorted by body ID, then frame
+};
+
+// Convert the records of a binary skeleton file between the passed frames to the CSV output layout.
+// Only the passed body is exported unless it is K4ABT_INVALID_BODY_ID. With storedAngles the angles and their names are the ones
+// stored in the file, otherwise the CSV options' angle table is calculated from the joints. Joints are filtered and derivatives
+// are calculated from them as the CSV options say.
+bool ExportSkeletonFile(const std::string& inputFileName, const std::string& outputFileName, uint32_t firstFrame, uint32_t lastFrame,
+                        uint32_t bodyId, const SkeletonCsvOptions& csvOptions, bool storedAngles);
@@ -0,0 +1,332 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SyntheticCapture.cpp
+ * Contains the synthetic capture source and the scripted body tracker.
+ */
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <cstring>
+
+#include "SyntheticCapture.h"
+
+// Scene layout in millimeters
+const float BACKGROUND_DEPTH = 3500.0f;
+const float BODY_DEPTH = 2500.0f;
+const float BODY_SPACING = 800.0f;
+const int BODY_MARGIN_PIXELS = 20; // Padding around the projected joints of a body in the depth image
+
+// Captures the scripted tracker holds before enqueueing waits, the same as the body tracking SDK
+const size_t SCRIPTED_TRACKER_QUEUE_SIZE = 3;
+
+// Joint positions of a body standing straight with its arms down, relative to the pelvis.
+// Camera coordinates are used, so y points down and z points away from the camera.
+const float REST_POSE[K4ABT_JOINT_COUNT][3] = {
+    {0.0f, 0.0f, 0.0f},        // Pelvis
+    {0.0f, -200.0f, 0.0f},     // Spine navel
+    {0.0f, -380.0f, 0.0f},     // Spine chest
+    {0.0f, -560.0f, 0.0f},     // Neck
+    {40.0f, -520.0f, 0.0f},    // Clavicle left
+    {180.0f, -500.0f, 0.0f},   // Shoulder left
+    {180.0f, -230.0f, 0.0f},   // Elbow left
+    {180.0f, 20.0f, 0.0f},     // Wrist left
+    {180.0f, 100.0f, 0.0f},    // Hand left
+    {180.0f, 180.0f, 0.0f},    // Hand tip left
+    {150.0f, 120.0f, -20.0f},  // Thumb left
+    {-40.0f, -520.0f, 0.0f},   // Clavicle right
+    {-180.0f, -500.0f, 0.0f},  // Shoulder right
+    {-180.0f, -230.0f, 0.0f},  // Elbow right
+    {-180.0f, 20.0f, 0.0f},    // Wrist right
+    {-180.0f, 100.0f, 0.0f},   // Hand right
+    {-180.0f, 180.0f, 0.0f},   // Hand tip right
+    {-150.0f, 120.0f, -20.0f}, // Thumb right
+    {100.0f, 0.0f, 0.0f},      // Hip left
+    {100.0f, 420.0f, 0.0f},    // Knee left
+    {100.0f, 820.0f, 0.0f},    // Ankle left
+    {100.0f, 860.0f, -120.0f}, // Foot left
+    {-100.0f, 0.0f, 0.0f},     // Hip right
+    {-100.0f, 420.0f, 0.0f},   // Knee right
+    {-100.0f, 820.0f, 0.0f},   // Ankle right
+    {-100.0f, 860.0f, -120.0f},// Foot right
+    {0.0f, -680.0f, 0.0f},     // Head
+    {0.0f, -660.0f, -100.0f},  // Nose
+    {35.0f, -700.0f, -80.0f},  // Eye left
+    {75.0f, -690.0f, 0.0f},    // Ear left
+    {-35.0f, -700.0f, -80.0f}, // Eye right
+    {-75.0f, -690.0f, 0.0f}    // Ear right
+};
+
+// Rotate the passed joints about the y-z plane of a pivot joint, towards the camera for positive angles
+static void bendJoints(float pose[][3], int pivot, const int* joints, int jointCount, float angle) {
+    float cosAngle = cosf(angle);
+    float sinAngle = sinf(angle);
+    for(int i = 0; i < jointCount; i++) {
+        float* position = pose[joints[i]];
+        float dy = position[1] - pose[pivot][1];
+        float dz = position[2] - pose[pivot][2];
+        position[1] = pose[pivot][1] + dy * cosAngle + dz * sinAngle;
+        position[2] = pose[pivot][2] - dy * sinAngle + dz * cosAngle;
+    }
+}
+
+void GetScriptedSkeleton(int bodyIndex, int bodyCount, double timeSeconds, k4abt_skeleton_t& skeleton) {
+    static const int LEFT_FOREARM[] = {K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_HAND_LEFT, K4ABT_JOINT_HANDTIP_LEFT, K4ABT_JOINT_THUMB_LEFT};
+    static const int RIGHT_FOREARM[] = {K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_HAND_RIGHT, K4ABT_JOINT_HANDTIP_RIGHT, K4ABT_JOINT_THUMB_RIGHT};
+    static const int LEFT_SHIN[] = {K4ABT_JOINT_ANKLE_LEFT, K4ABT_JOINT_FOOT_LEFT};
+    static const int RIGHT_SHIN[] = {K4ABT_JOINT_ANKLE_RIGHT, K4ABT_JOINT_FOOT_RIGHT};
+
+    float pose[K4ABT_JOINT_COUNT][3];
+    memcpy(pose, REST_POSE, sizeof(pose));
+
+    // Give each body its own phase so they do not move in step
+    float t = (float) timeSeconds;
+    float phase = bodyIndex * 1.3f;
+    float degrees = (float) M_PI / 180.0f;
+
+    // Elbows bend between 0 and 120 degrees and knees between 0 and 60 degrees, backwards
+    float leftElbow = 60.0f * (1.0f - cosf(2.0f * (float) M_PI * 0.5f * t + phase)) * degrees;
+    float rightElbow = 60.0f * (1.0f - cosf(2.0f * (float) M_PI * 0.4f * t + phase)) * degrees;
+    float leftKnee = 30.0f * (1.0f - cosf(2.0f * (float) M_PI * 0.3f * t + phase)) * degrees;
+    float rightKnee = 30.0f * (1.0f - cosf(2.0f * (float) M_PI * 0.3f * t + phase + (float) M_PI)) * degrees;
+    bendJoints(pose, K4ABT_JOINT_ELBOW_LEFT, LEFT_FOREARM, 4, leftElbow);
+    bendJoints(pose, K4ABT_JOINT_ELBOW_RIGHT, RIGHT_FOREARM, 4, rightElbow);
+    bendJoints(pose, K4ABT_JOINT_KNEE_LEFT, LEFT_SHIN, 2, -leftKnee);
+    bendJoints(pose, K4ABT_JOINT_KNEE_RIGHT, RIGHT_SHIN, 2, -rightKnee);
+
+    // Bodies stand side by side in front of the camera and sway around their place
+    float pelvisX = (bodyIndex - (bodyCount - 1) / 2.0f) * BODY_SPACING + 200.0f * sinf(2.0f * (float) M_PI * 0.2f * t + phase);
+    float pelvisZ = BODY_DEPTH + 300.0f * sinf(2.0f * (float) M_PI * 0.1f * t + phase);
+
+    for(int joint = 0; joint < static_cast<int>(K4ABT_JOINT_COUNT); joint++) {
+        k4abt_joint_t& output = skeleton.joints[joint];
+        output.position.xyz.x = pelvisX + pose[joint][0];
+        output.position.xyz.y = pose[joint][1];
+        output.position.xyz.z = pelvisZ + pose[joint][2];
+        output.orientation.wxyz.w = 1.0f;
+        output.orientation.wxyz.x = 0.0f;
+        output.orientation.wxyz.y = 0.0f;
+        output.orientation.wxyz.z = 0.0f;
+        output.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+    }
+}
+
+// Pixel rectangle covered by a skeleton in the depth image, clipped to the image. Right and bottom are exclusive.
+static void getBodyRectangle(const k4a_calibration_t& calibration, const k4abt_skeleton_t& skeleton,
+                             int& left, int& top, int& right, int& bottom) {
+    const k4a_calibration_camera_t& camera = calibration.depth_camera_calibration;
+    const auto& intrinsics = camera.intrinsics.parameters.param;
+
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for(int joint = 0; joint < static_cast<int>(K4ABT_JOINT_COUNT); joint++) {
+        const k4a_float3_t& position = skeleton.joints[joint].position;
+        float x = intrinsics.fx * position.xyz.x / position.xyz.z + intrinsics.cx;
+        float y = intrinsics.fy * position.xyz.y / position.xyz.z + intrinsics.cy;
+        minX = x < minX ? x : minX;
+        minY = y < minY ? y : minY;
+        maxX = x > maxX ? x : maxX;
+        maxY = y > maxY ? y : maxY;
+    }
+
+    left = (int) minX - BODY_MARGIN_PIXELS;
+    top = (int) minY - BODY_MARGIN_PIXELS;
+    right = (int) maxX + BODY_MARGIN_PIXELS + 1;
+    bottom = (int) maxY + BODY_MARGIN_PIXELS + 1;
+
+    left = left < 0 ? 0 : left;
+    top = top < 0 ? 0 : top;
+    right = right > camera.resolution_width ? camera.resolution_width : right;
+    bottom = bottom > camera.resolution_height ? camera.resolution_height : bottom;
+}
+
+SyntheticCaptureSource::SyntheticCaptureSource(k4a_depth_mode_t depthMode, int bodyCount, int frameRate, uint32_t frameCount)
+    : m_bodyCount(bodyCount < 0 ? 0 : (bodyCount > SYNTHETIC_MAX_BODIES ? SYNTHETIC_MAX_BODIES : bodyCount)),
+      m_framePeriodUsec(frameRate > 0 ? 1000000 / frameRate : 33333),
+      m_frameCount(frameCount) {
+    // Use the resolution and field of view of the passed depth mode with an ideal pinhole camera
+    int width = 640;
+    int height = 576;
+    float fieldOfView = 75.0f;
+    switch(depthMode) {
+        case K4A_DEPTH_MODE_NFOV_2X2BINNED:
+            width = 320;
+            height = 288;
+            break;
+        case K4A_DEPTH_MODE_WFOV_2X2BINNED:
+            width = 512;
+            height = 512;
+            fieldOfView = 120.0f;
+            break;
+        case K4A_DEPTH_MODE_WFOV_UNBINNED:
+            width = 1024;
+            height = 1024;
+            fieldOfView = 120.0f;
+            break;
+        default:
+            depthMode = K4A_DEPTH_MODE_NFOV_UNBINNED;
+            break;
+    }
+
+    float focalLength = (width / 2.0f) / tanf(fieldOfView / 2.0f * (float) M_PI / 180.0f);
+    float centerX = (width - 1) / 2.0f;
+    float centerY = (height - 1) / 2.0f;
+
+    k4a_calibration_camera_t& camera = m_calibration.depth_camera_calibration;
+    camera.resolution_width = width;
+    camera.resolution_height = height;
+    camera.intrinsics.type = K4A_CALIBRATION_LENS_DISTORTION_MODEL_BROWN_CONRADY;
+    camera.intrinsics.parameter_count = 14;
+    camera.intrinsics.parameters.param.cx = centerX;
+    camera.intrinsics.parameters.param.cy = centerY;
+    camera.intrinsics.parameters.param.fx = focalLength;
+    camera.intrinsics.parameters.param.fy = focalLength;
+
+    // Every pixel has to be inside the metric radius to be unprojected
+    float cornerRadius = sqrtf(centerX * centerX + centerY * centerY) / focalLength;
+    camera.metric_radius = cornerRadius * 1.1f;
+    camera.intrinsics.parameters.param.metric_radius = camera.metric_radius;
+
+    // Every sensor is at the same place
+    const float identity[9] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+    memcpy(camera.extrinsics.rotation, identity, sizeof(identity));
+    for(int from = 0; from < K4A_CALIBRATION_TYPE_NUM; from++) {
+        for(int to = 0; to < K4A_CALIBRATION_TYPE_NUM; to++) {
+            memcpy(m_calibration.extrinsics[from][to].rotation, identity, sizeof(identity));
+        }
+    }
+
+    m_calibration.depth_mode = depthMode;
+    m_calibration.color_resolution = K4A_COLOR_RESOLUTION_OFF;
+}
+
+CaptureResult SyntheticCaptureSource::NextCapture(k4a_capture_t& capture, int32_t /*timeoutMs*/) {
+    if(m_frameCount > 0 && m_nextFrame >= m_frameCount) {
+        return CaptureResult::EndOfStream;
+    }
+
+    int width = m_calibration.depth_camera_calibration.resolution_width;
+    int height = m_calibration.depth_camera_calibration.resolution_height;
+
+    k4a_image_t depthImage = NULL;
+    if(k4a_image_create(K4A_IMAGE_FORMAT_DEPTH16, width, height, width * (int) sizeof(uint16_t), &depthImage) != K4A_RESULT_SUCCEEDED) {
+        return CaptureResult::Failed;
+    }
+
+    // Timestamps start one frame period in, like a device that has just started its cameras
+    uint64_t deviceTimestamp = (m_nextFrame + 1) * m_framePeriodUsec;
+    uint64_t systemTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    k4a_image_set_device_timestamp_usec(depthImage, deviceTimestamp);
+    k4a_image_set_system_timestamp_nsec(depthImage, systemTimestamp);
+
+    // Draw the background, then each body at the depth of its pelvis
+    uint16_t* depthBuffer = reinterpret_cast<uint16_t*>(k4a_image_get_buffer(depthImage));
+    for(int i = 0; i < width * height; i++) {
+        depthBuffer[i] = (uint16_t) BACKGROUND_DEPTH;
+    }
+
+    for(int body = 0; body < m_bodyCount; body++) {
+        k4abt_skeleton_t skeleton;
+        GetScriptedSkeleton(body, m_bodyCount, deviceTimestamp / 1000000.0, skeleton);
+        uint16_t bodyDepth = (uint16_t) skeleton.joints[K4ABT_JOINT_PELVIS].position.xyz.z;
+
+        int left, top, right, bottom;
+        getBodyRectangle(m_calibration, skeleton, left, top, right, bottom);
+        for(int y = top; y < bottom; y++) {
+            for(int x = left; x < right; x++) {
+                depthBuffer[y * width + x] = bodyDepth;
+            }
+        }
+    }
+
+    if(k4a_capture_create(&capture) != K4A_RESULT_SUCCEEDED) {
+        k4a_image_release(depthImage);
+        return CaptureResult::Failed;
+    }
+
+    // The capture takes its own reference to the image
+    k4a_capture_set_depth_image(capture, depthImage);
+    k4a_image_release(depthImage);
+
+    m_nextFrame++;
+    return CaptureResult::Succeeded;
+}
+
+ScriptedBodyTracker::ScriptedBodyTracker(const k4a_calibration_t& calibration, int bodyCount)
+    : m_calibration(calibration), m_bodyCount(bodyCount), m_queue(SCRIPTED_TRACKER_QUEUE_SIZE) {}
+
+ScriptedBodyTracker::~ScriptedBodyTracker() {
+    // Release captures that were enqueued but never popped
+    m_queue.Close();
+    k4a_capture_t capture = NULL;
+    while(m_queue.Pop(capture)) {
+        k4a_capture_release(capture);
+    }
+}
+
+// Only waiting forever and not waiting are supported; other timeouts wait forever
+k4a_wait_result_t ScriptedBodyTracker::EnqueueCapture(k4a_capture_t capture, int32_t timeoutMs) {
+    k4a_capture_reference(capture);
+
+    if(timeoutMs == 0) {
+        if(!m_queue.TryPush(capture)) {
+            k4a_capture_release(capture);
+            return K4A_WAIT_RESULT_TIMEOUT;
+        }
+    }
+    else if(!m_queue.Push(capture)) {
+        // The tracker was shut down
+        k4a_capture_release(capture);
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+k4a_wait_result_t ScriptedBodyTracker::PopResult(BodyFrame& frame, int32_t timeoutMs) {
+    frame.Release();
+
+    k4a_capture_t capture = NULL;
+    bool popped = timeoutMs == K4A_WAIT_INFINITE ? m_queue.Pop(capture) : m_queue.TryPop(capture, std::chrono::milliseconds(timeoutMs));
+    if(!popped) {
+        return m_queue.IsFinished() ? K4A_WAIT_RESULT_FAILED : K4A_WAIT_RESULT_TIMEOUT;
+    }
+
+    frame.DepthImage = k4a_capture_get_depth_image(capture);
+    k4a_capture_release(capture);
+    if(frame.DepthImage == NULL) {
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    frame.DeviceTimestampUsec = k4a_image_get_device_timestamp_usec(frame.DepthImage);
+    frame.SystemTimestampNsec = k4a_image_get_system_timestamp_nsec(frame.DepthImage);
+
+    int width = m_calibration.depth_camera_calibration.resolution_width;
+    int height = m_calibration.depth_camera_calibration.resolution_height;
+    if(k4a_image_create(K4A_IMAGE_FORMAT_CUSTOM8, width, height, width, &frame.BodyIndexMap) != K4A_RESULT_SUCCEEDED) {
+        frame.BodyIndexMap = NULL;
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    // Mark the same rectangles the capture source drew in the depth image
+    uint8_t* bodyIndexMap = k4a_image_get_buffer(frame.BodyIndexMap);
+    memset(bodyIndexMap, K4ABT_BODY_INDEX_MAP_BACKGROUND, (size_t) width * height);
+
+    frame.Bodies.resize(m_bodyCount);
+    for(int body = 0; body < m_bodyCount; body++) {
+        frame.Bodies[body].id = body + 1;
+        GetScriptedSkeleton(body, m_bodyCount, frame.DeviceTimestampUsec / 1000000.0, frame.Bodies[body].skeleton);
+
+        int left, top, right, bottom;
+        getBodyRectangle(m_calibration, frame.Bodies[body].skeleton, left, top, right, bottom);
+        for(int y = top; y < bottom; y++) {
+            memset(bodyIndexMap + y * width + left, body, right > left ? right - left : 0);
+        }
+    }
+
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+void ScriptedBodyTracker::Shutdown() {
+    m_queue.Close();
+}
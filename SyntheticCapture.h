@@ -0,0 +1,67 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * SyntheticCapture.h
+ * Contains a capture source that generates depth frames of moving bodies
+ * and a body tracker that returns their scripted skeletons. Together they
+ * run data collection without an Azure Kinect, a recording or a GPU.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "BoundedQueue.h"
+#include "BodyTracker.h"
+#include "CaptureSource.h"
+
+// Most bodies a synthetic session can have
+const int SYNTHETIC_MAX_BODIES = 6;
+
+// Generates depth frames with a rectangle of constant depth for each scripted body
+class SyntheticCaptureSource : public CaptureSource {
+public:
+    // A frame count of 0 generates frames until the session is stopped. Frames are generated as fast
+    // as they are processed; the frame rate only sets the spacing of their device timestamps.
+    SyntheticCaptureSource(k4a_depth_mode_t depthMode, int bodyCount, int frameRate, uint32_t frameCount);
+
+    const k4a_calibration_t& Calibration() const override { return m_calibration; }
+    std::vector<uint8_t> RawCalibration() const override { return std::vector<uint8_t>(); }
+    bool IsLive() const override { return false; }
+    uint64_t FramePeriodUsec() const override { return m_framePeriodUsec; }
+    CaptureResult NextCapture(k4a_capture_t& capture, int32_t timeoutMs) override;
+
+    int BodyCount() const { return m_bodyCount; }
+
+private:
+    k4a_calibration_t m_calibration = {};
+    int m_bodyCount;
+    uint64_t m_framePeriodUsec;
+    uint32_t m_frameCount;
+    uint32_t m_nextFrame = 0;
+};
+
+// Returns the scripted skeletons of a synthetic capture source instead of running the body tracking SDK.
+// Bodies have IDs 1 to the body count and every joint has medium confidence.
+class ScriptedBodyTracker : public BodyTracker {
+public:
+    ScriptedBodyTracker(const k4a_calibration_t& calibration, int bodyCount);
+    ~ScriptedBodyTracker();
+
+    ScriptedBodyTracker(const ScriptedBodyTracker&) = delete;
+    ScriptedBodyTracker& operator=(const ScriptedBodyTracker&) = delete;
+
+    k4a_wait_result_t EnqueueCapture(k4a_capture_t capture, int32_t timeoutMs) override;
+    k4a_wait_result_t PopResult(BodyFrame& frame, int32_t timeoutMs) override;
+    void Shutdown() override;
+
+private:
+    k4a_calibration_t m_calibration;
+    int m_bodyCount;
+    BoundedQueue<k4a_capture_t> m_queue;
+};
+
+// Skeleton of a scripted body at the passed time since the start of the session.
+// Bodies stand side by side, sway around their place and bend their elbows and knees.
+void GetScriptedSkeleton(int bodyIndex, int bodyCount, double timeSeconds, k4abt_skeleton_t& skeleton);
@@ -0,0 +1,281 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ * 
+ * batch.cpp
+ * Contains functions for processing many pre-recorded video files
+ * concurrently, each in its own headless process. The body tracking SDK
+ * only allows one tracker per process, so recordings cannot share one.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+#include "3DViewer.h"
+#include "SkeletonFile.h"
+
+namespace fs = std::filesystem;
+
+// Input and output file of a single recording in a batch
+struct BatchJob {
+    std::string InputFileName;
+    std::string OutputFileName;
+};
+
+// Check if a filename matches a pattern with * and ? wildcards, ignoring case
+bool wildcardMatch(const std::string& pattern, const std::string& name) {
+    size_t p = 0, n = 0;
+    size_t starP = std::string::npos, starN = 0;
+
+    while(n < name.size()) {
+        if(p < pattern.size() && (pattern[p] == '?' ||
+           std::tolower((unsigned char) pattern[p]) == std::tolower((unsigned char) name[n]))) {
+            p++;
+            n++;
+        }
+        else if(p < pattern.size() && pattern[p] == '*') {
+            // Remember the star and first try matching it against nothing
+            starP = p++;
+            starN = n;
+        }
+        else if(starP != std::string::npos) {
+            // Let the last star match one more character
+            p = starP + 1;
+            n = ++starN;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while(p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+
+    return p == pattern.size();
+}
+
+// Check if a path has an .mkv extension, ignoring case
+bool isRecording(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    return extension == ".mkv";
+}
+
+// Get the recordings named by a BATCH argument, which can be a directory, a wildcard pattern,
+// a single .mkv file or a manifest file listing one recording per line
+std::vector<std::string> expandBatchInput(const std::string& batchInput) {
+    std::vector<std::string> inputFiles;
+    std::error_code error;
+
+    if(fs::is_directory(batchInput, error)) {
+        for(const fs::directory_entry& entry : fs::directory_iterator(batchInput, error)) {
+            if(entry.is_regular_file(error) && isRecording(entry.path())) {
+                inputFiles.push_back(entry.path().string());
+            }
+        }
+        std::sort(inputFiles.begin(), inputFiles.end());
+    }
+    else if(batchInput.find_first_of("*?") != std::string::npos) {
+        fs::path pattern(batchInput);
+        fs::path directory = pattern.has_parent_path() ? pattern.parent_path() : fs::path(".");
+        std::string filenamePattern = pattern.filename().string();
+
+        for(const fs::directory_entry& entry : fs::directory_iterator(directory, error)) {
+            if(entry.is_regular_file(error) && wildcardMatch(filenamePattern, entry.path().filename().string())) {
+                inputFiles.push_back(entry.path().string());
+            }
+        }
+        std::sort(inputFiles.begin(), inputFiles.end());
+    }
+    else if(isRecording(batchInput)) {
+        inputFiles.push_back(batchInput);
+    }
+    else {
+        // Read a manifest file, skipping empty lines and lines starting with #
+        std::ifstream manifest(batchInput);
+        if(!manifest.is_open()) {
+            printf("Open manifest %s failed.\n", batchInput.c_str());
+            return inputFiles;
+        }
+
+        std::string line;
+        while(std::getline(manifest, line)) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if(start == std::string::npos || line[start] == '#') {
+                continue;
+            }
+            size_t end = line.find_last_not_of(" \t\r");
+            inputFiles.push_back(line.substr(start, end - start + 1));
+        }
+    }
+
+    return inputFiles;
+}
+
+// Quote an argument for a Windows command line, so paths with spaces and quotes reach the job unchanged
+std::string quoteArgument(const std::string& argument) {
+    if(!argument.empty() && argument.find_first_of(" \t\"") == std::string::npos) {
+        return argument;
+    }
+
+    // Backslashes are only escaped before a quote, including the closing one
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for(char c : argument) {
+        if(c == '\\') {
+            backslashes++;
+            continue;
+        }
+
+        quoted.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+        quoted += c;
+        backslashes = 0;
+    }
+    quoted.append(2 * backslashes, '\\');
+    quoted += '"';
+    return quoted;
+}
+
+// Run a command line as a child process and return its exit code, or -1 if it could not be started
+int runProcess(const std::string& commandLine) {
+    STARTUPINFOA startupInfo = {sizeof(STARTUPINFOA)};
+    PROCESS_INFORMATION processInfo = {};
+    std::vector<char> commandBuffer(commandLine.begin(), commandLine.end());
+    commandBuffer.push_back('\0');
+
+    if(!CreateProcessA(NULL, commandBuffer.data(), NULL, NULL, FALSE, 0, NULL, NULL, &startupInfo, &processInfo)) {
+        printf("Start process failed (error %lu): %s\n", GetLastError(), commandLine.c_str());
+        return -1;
+    }
+
+    WaitForSingleObject(processInfo.hProcess, INFINITE);
+    DWORD exitCode = 1;
+    GetExitCodeProcess(processInfo.hProcess, &exitCode);
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    return (int) exitCode;
+}
+
+// Write the frame count of a batch job for its batch to read back with readFrameCountFile
+bool WriteFrameCountFile(const std::string& fileName, int processedFrames) {
+    std::ofstream file(fileName);
+    file << processedFrames << "\n";
+    file.close();
+    if(file.fail()) {
+        printf("Write file %s failed.\n", fileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read the number of processed frames a job wrote with FRAME_COUNT_FILE and delete the file, or return -1 if it has none
+long long readFrameCountFile(const std::string& fileName) {
+    long long frames = -1;
+    std::ifstream file(fileName);
+    if(!(file >> frames) || frames < 0) {
+        frames = -1;
+    }
+    file.close();
+    remove(fileName.c_str());
+    return frames;
+}
+
+// Process recordings until every job in the batch has been taken. Each recording runs in its own process,
+// so a recording that fails, even in the body tracker, only fails its own job. A job succeeds if its process
+// exits with code 0, even if the recording has no frames.
+void runBatchWorker(const std::string& executable, const InputSettings& baseSettings, const std::vector<BatchJob>& jobs,
+                    std::atomic<size_t>& nextJob, std::atomic<long long>& totalFrames, std::atomic<int>& failedJobs) {
+    size_t jobIndex;
+    while((jobIndex = nextJob++) < jobs.size()) {
+        const BatchJob& job = jobs[jobIndex];
+        printf("[%zu/%zu] Processing %s -> %s\n", jobIndex + 1, jobs.size(), job.InputFileName.c_str(), job.OutputFileName.c_str());
+
+        // The job reports its frame count in a file of its own next to its output
+        std::string frameCountFileName = job.OutputFileName + BATCH_FRAME_COUNT_EXTENSION;
+        std::string commandLine = quoteArgument(executable) + " HEADLESS OFFLINE " + quoteArgument(job.InputFileName) +
+                                  " OUTPUT " + quoteArgument(job.OutputFileName) + " FRAME_COUNT_FILE " + quoteArgument(frameCountFileName);
+        for(const std::string& argument : baseSettings.BatchArguments) {
+            commandLine += " " + quoteArgument(argument);
+        }
+
+        int exitCode = runProcess(commandLine);
+        long long frames = readFrameCountFile(frameCountFileName);
+        if(exitCode != 0) {
+            printf("[%zu/%zu] Processing %s failed (exit code %d).\n", jobIndex + 1, jobs.size(), job.InputFileName.c_str(), exitCode);
+            failedJobs++;
+        }
+        else if(frames < 0) {
+            printf("[%zu/%zu] Processing %s did not report its frame count.\n", jobIndex + 1, jobs.size(), job.InputFileName.c_str());
+        }
+        else {
+            totalFrames += frames;
+        }
+    }
+}
+
+// Run body tracking data collection on every recording in a batch with a pool of workers
+int RunBatch(InputSettings inputSettings) {
+    // Every recording is processed by another instance of this program
+    char executable[MAX_PATH];
+    DWORD executableLength = GetModuleFileNameA(NULL, executable, MAX_PATH);
+    if(executableLength == 0 || executableLength >= MAX_PATH) {
+        printf("Get executable path failed.\n");
+        return -1;
+    }
+
+    std::vector<std::string> inputFiles = expandBatchInput(inputSettings.BatchInput);
+    if(inputFiles.empty()) {
+        printf("No recordings found for %s.\n", inputSettings.BatchInput.c_str());
+        return -1;
+    }
+
+    // Write each output next to its recording, or in the output directory if one was given
+    std::vector<BatchJob> jobs;
+    for(const std::string& inputFile : inputFiles) {
+        fs::path outputPath = inputSettings.OutputFileName.empty() ?
+                              fs::path(inputFile) : fs::path(inputSettings.OutputFileName) / fs::path(inputFile).filename();
+        outputPath.replace_extension(inputSettings.BinaryOutput ? SKELETON_FILE_EXTENSION : ".csv");
+
+        if(fileExists(outputPath.string())) {
+            printf("File %s already exists, skipping %s.\n", outputPath.string().c_str(), inputFile.c_str());
+            continue;
+        }
+
+        jobs.push_back({inputFile, outputPath.string()});
+    }
+
+    int workerCount = std::max(1, std::min(inputSettings.BatchJobs, (int) jobs.size()));
+    printf("Processing %zu recordings with %d workers.\n", jobs.size(), workerCount);
+
+    std::atomic<size_t> nextJob(0);
+    std::atomic<long long> totalFrames(0);
+    std::atomic<int> failedJobs(0);
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i < workerCount; i++) {
+        workers.emplace_back(runBatchWorker, std::string(executable), std::cref(inputSettings), std::cref(jobs),
+                             std::ref(nextJob), std::ref(totalFrames), std::ref(failedJobs));
+    }
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(endTime - startTime).count();
+
+    printf("\nBatch finished: %zu recordings (%d failed), %lld frames in %.3f s (%.1f frames/s).\n",
+           jobs.size(), failedJobs.load(), totalFrames.load(), elapsedSeconds,
+           elapsedSeconds > 0 ? totalFrames / elapsedSeconds : 0.0);
+    return failedJobs;
+}
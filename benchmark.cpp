@@ -0,0 +1,442 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * benchmark.cpp
+ * Contains a micro-benchmark of the point cloud vertex builders on
+ * generated frames, compared against the previous per-point loop, and of
+ * the packed vertex builder and its upload size, and of the joint angle
+ * calculator with growing angle tables.
+ */
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <BodyTrackingHelpers.h>
+#include <PointCloudVertexBuilder.h>
+
+#include "3DViewer.h"
+#include "JointAngles.h"
+
+using Visualization::PackedPointCloudVertex;
+using Visualization::PointCloudKernel;
+using Visualization::PointCloudVertex;
+
+// Frames built by each implementation at each resolution
+const int BENCHMARK_FRAMES = 200;
+
+// Bodies in each frame and frames calculated by the joint angle benchmark
+const int ANGLE_BENCHMARK_BODIES = 6;
+const int ANGLE_BENCHMARK_FRAMES = 20000;
+
+// Depth resolution to benchmark
+struct BenchmarkResolution {
+    const char* Name;
+    int Width;
+    int Height;
+};
+
+// Generate the point cloud and body index map of two bodies in front of a wall.
+// Pixels outside the valid depth area and scattered holes have a depth of 0, like real frames.
+void makeBenchmarkFrame(int width, int height, std::vector<int16_t>& pointCloud, std::vector<uint8_t>& bodyIndexMap) {
+    pointCloud.resize(3 * (size_t) width * height);
+    bodyIndexMap.assign((size_t) width * height, K4ABT_BODY_INDEX_MAP_BACKGROUND);
+
+    uint32_t seed = 12345;
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            size_t i = (size_t) y * width + x;
+            seed = seed * 1664525u + 1013904223u;
+
+            bool inBodyRows = y >= height / 6 && y < height * 5 / 6;
+            int16_t z = 3500;
+            if(inBodyRows && x >= width / 5 && x < width * 2 / 5) {
+                bodyIndexMap[i] = 0;
+                z = 2500;
+            }
+            else if(inBodyRows && x >= width * 3 / 5 && x < width * 4 / 5) {
+                bodyIndexMap[i] = 1;
+                z = 2000;
+            }
+
+            float dx = (x - width / 2.0f) / (width / 2.0f);
+            float dy = (y - height / 2.0f) / (height / 2.0f);
+            if(dx * dx + dy * dy > 1.3f || (seed >> 24) < 20) {
+                z = 0;
+            }
+
+            pointCloud[3 * i + 0] = (int16_t) ((x - width / 2) * z / width);
+            pointCloud[3 * i + 1] = (int16_t) ((y - height / 2) * z / width);
+            pointCloud[3 * i + 2] = z;
+        }
+    }
+}
+
+// Same blending as Window3dWrapper::BlendBodyColor
+void blendBenchmarkColor(float* color, const Color& bodyColor) {
+    color[0] = bodyColor.r * 0.8f + color[0] * 0.8f;
+    color[1] = bodyColor.g * 0.8f + color[1] * 0.8f;
+    color[2] = bodyColor.b * 0.8f + color[2] * 0.8f;
+}
+
+// The point cloud loop the vertex builders replaced: blend a color per point and append each valid point
+void buildPreviousVertices(const int16_t* pointCloud, const std::vector<Color>& pointCloudColors, int width, int height,
+                           std::vector<PointCloudVertex>& vertices) {
+    vertices.clear();
+    for(int h = 0; h < height; h++) {
+        for(int w = 0; w < width; w++) {
+            int pixelIndex = h * width + w;
+            float position[3] = {
+                static_cast<float>(pointCloud[3 * pixelIndex + 0]),
+                static_cast<float>(pointCloud[3 * pixelIndex + 1]),
+                static_cast<float>(pointCloud[3 * pixelIndex + 2])};
+
+            if(position[2] == 0) {
+                continue;
+            }
+
+            PointCloudVertex vertex;
+            float color[4] = {0.8f, 0.8f, 0.8f, 0.6f};
+            blendBenchmarkColor(color, pointCloudColors[pixelIndex]);
+            for(int i = 0; i < 3; i++) {
+                vertex.Position[i] = position[i] * 0.001f;
+            }
+            memcpy(vertex.Color, color, sizeof(vertex.Color));
+            vertex.PixelLocation[0] = w;
+            vertex.PixelLocation[1] = h;
+            vertices.push_back(vertex);
+        }
+    }
+}
+
+// Largest difference from the double precision angle that angle calculations may have, in degrees
+const double ANGLE_BENCHMARK_TOLERANCE = 0.001;
+
+// Generate skeletons with scattered joint positions in millimeters, like a few people in front of the camera.
+// Every other body has a fully extended left knee, where angles are hardest to calculate accurately.
+void makeBenchmarkBodies(std::vector<k4abt_body_t>& bodies) {
+    bodies.resize(ANGLE_BENCHMARK_BODIES);
+    uint32_t seed = 12345;
+    for(size_t i = 0; i < bodies.size(); i++) {
+        bodies[i].id = (uint32_t) i + 1;
+        for(int j = 0; j < K4ABT_JOINT_COUNT; j++) {
+            k4abt_joint_t& joint = bodies[i].skeleton.joints[j];
+            for(int k = 0; k < 3; k++) {
+                seed = seed * 1664525u + 1013904223u;
+                joint.position.v[k] = (float) (seed >> 16) / 65536.0f * 1000.0f - 500.0f + (k == 2 ? 2500.0f : 0.0f);
+            }
+            joint.orientation.v[0] = 1.0f;
+            joint.orientation.v[1] = joint.orientation.v[2] = joint.orientation.v[3] = 0.0f;
+            joint.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+        }
+
+        if(i % 2 == 1) {
+            k4abt_joint_t* joints = bodies[i].skeleton.joints;
+            for(int k = 0; k < 3; k++) {
+                float thigh = joints[K4ABT_JOINT_KNEE_LEFT].position.v[k] - joints[K4ABT_JOINT_HIP_LEFT].position.v[k];
+                joints[K4ABT_JOINT_ANKLE_LEFT].position.v[k] = joints[K4ABT_JOINT_KNEE_LEFT].position.v[k] + thigh + (k == 0 ? 0.01f * i : 0.0f);
+            }
+        }
+    }
+}
+
+// Angle at p2 in degrees, calculated in double precision
+double referenceAngle(const k4a_float3_t& p1, const k4a_float3_t& p2, const k4a_float3_t& p3) {
+    double ax = (double) p1.xyz.x - p2.xyz.x, ay = (double) p1.xyz.y - p2.xyz.y, az = (double) p1.xyz.z - p2.xyz.z;
+    double bx = (double) p3.xyz.x - p2.xyz.x, by = (double) p3.xyz.y - p2.xyz.y, bz = (double) p3.xyz.z - p2.xyz.z;
+    double crossX = ay * bz - az * by, crossY = az * bx - ax * bz, crossZ = ax * by - ay * bx;
+    return atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), ax * bx + ay * by + az * bz) * 180 / M_PI;
+}
+
+// Largest difference of the first four angles of each body from the double precision default angles, or infinity if one is not a number
+double maxAngleError(const std::vector<k4abt_body_t>& bodies, const float* angles, size_t angleStride) {
+    const k4abt_joint_id_t defaultJoints[4][3] = {
+        {K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_SHOULDER_LEFT},
+        {K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT},
+        {K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT},
+        {K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT}
+    };
+
+    double maxError = 0.0;
+    for(size_t i = 0; i < bodies.size(); i++) {
+        const k4abt_joint_t* joints = bodies[i].skeleton.joints;
+        for(int k = 0; k < 4; k++) {
+            double reference = referenceAngle(joints[defaultJoints[k][0]].position, joints[defaultJoints[k][1]].position, joints[defaultJoints[k][2]].position);
+            double error = fabs(angles[i * angleStride + k] - reference);
+            maxError = std::isnan(error) ? INFINITY : (error > maxError ? error : maxError);
+        }
+    }
+    return maxError;
+}
+
+// Joint positions of an angle the calculator has to handle exactly, and the angle it has to return
+struct DegenerateAngleCase {
+    const char* Name;
+    float First[3];
+    float Vertex[3];
+    float Last[3];
+    bool Tracked;
+    float Expected; // Degrees, or JOINT_ANGLE_INVALID
+};
+
+// Check the angles of untracked joints, segments without length and collinear segments. Each case fills every
+// default angle of its own body, so it is checked in every lane and next to the other cases.
+bool checkDegenerateAngles() {
+    const DegenerateAngleCase cases[] = {
+        {"Untracked joint", {300.0f, -100.0f, 2500.0f}, {100.0f, 200.0f, 2000.0f}, {-200.0f, 400.0f, 2100.0f}, false, JOINT_ANGLE_INVALID},
+        {"Coincident joints", {100.0f, 200.0f, 2000.0f}, {100.0f, 200.0f, 2000.0f}, {-200.0f, 400.0f, 2100.0f}, true, JOINT_ANGLE_INVALID},
+        {"Collinear, 0 degrees", {300.0f, -100.0f, 2500.0f}, {100.0f, 200.0f, 2000.0f}, {500.0f, -400.0f, 3000.0f}, true, 0.0f},
+        {"Collinear, 180 degrees", {300.0f, -100.0f, 2500.0f}, {100.0f, 200.0f, 2000.0f}, {-100.0f, 500.0f, 1500.0f}, true, 180.0f},
+        {"Right angle", {300.0f, 200.0f, 2000.0f}, {100.0f, 200.0f, 2000.0f}, {100.0f, 200.0f, 2300.0f}, true, 90.0f}
+    };
+    const size_t caseCount = sizeof(cases) / sizeof(cases[0]);
+
+    JointAngleTable table;
+    std::vector<k4abt_body_t> bodies;
+    makeBenchmarkBodies(bodies);
+    bodies.resize(caseCount);
+    for(size_t i = 0; i < caseCount; i++) {
+        for(size_t k = 0; k < table.Count(); k++) {
+            k4abt_joint_t* joints = bodies[i].skeleton.joints;
+            const float* positions[3] = {cases[i].First, cases[i].Vertex, cases[i].Last};
+            for(int j = 0; j < 3; j++) {
+                k4abt_joint_t& joint = joints[table[k].Joints[j]];
+                memcpy(joint.position.v, positions[j], sizeof(joint.position.v));
+                joint.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+            }
+            if(!cases[i].Tracked) {
+                joints[table[k].Joints[0]].confidence_level = K4ABT_JOINT_CONFIDENCE_NONE;
+            }
+        }
+    }
+
+    JointAngleCalculator calculator(table);
+    calculator.Compute(bodies.data(), bodies.size());
+
+    bool matches = true;
+    for(size_t i = 0; i < caseCount; i++) {
+        // Measured angles are also checked against the double precision calculation
+        if(IsJointAngleValid(cases[i].Expected)) {
+            const k4abt_joint_t* joints = bodies[i].skeleton.joints;
+            double reference = referenceAngle(joints[table[0].Joints[0]].position, joints[table[0].Joints[1]].position, joints[table[0].Joints[2]].position);
+            if(fabs(reference - cases[i].Expected) > ANGLE_BENCHMARK_TOLERANCE) {
+                printf("  %s: reference %g degrees, expected %g\n", cases[i].Name, reference, cases[i].Expected);
+                matches = false;
+            }
+        }
+
+        const float* angles = calculator.Angles(i);
+        for(size_t k = 0; k < table.Count(); k++) {
+            bool same = IsJointAngleValid(cases[i].Expected) ?
+                fabs(angles[k] - cases[i].Expected) <= ANGLE_BENCHMARK_TOLERANCE : !IsJointAngleValid(angles[k]);
+            if(!same) {
+                printf("  %s, %s: %g degrees, expected %g\n", cases[i].Name, table[k].Name.c_str(), angles[k], cases[i].Expected);
+                matches = false;
+            }
+        }
+    }
+
+    printf("  Untracked, coincident and collinear joints: %s\n", matches ? "match" : "DO NOT MATCH");
+    return matches;
+}
+
+// The angle calculation the angle table replaced: a scalar call per hard-coded angle
+float previousThreePointsToAngle(const k4a_float3_t& p1, const k4a_float3_t& p2, const k4a_float3_t& p3) {
+    float x1 = p1.xyz.x - p2.xyz.x, y1 = p1.xyz.y - p2.xyz.y, z1 = p1.xyz.z - p2.xyz.z;
+    float x2 = p3.xyz.x - p2.xyz.x, y2 = p3.xyz.y - p2.xyz.y, z2 = p3.xyz.z - p2.xyz.z;
+
+    float dotProduct = x1 * x2 + y1 * y2 + z1 * z2;
+    float vec1Mag = sqrtf(x1 * x1 + y1 * y1 + z1 * z1);
+    float vec2Mag = sqrtf(x2 * x2 + y2 * y2 + z2 * z2);
+    return acosf(dotProduct / (vec1Mag * vec2Mag)) * 180 / (float) M_PI;
+}
+
+// Time the angle calculator with tables of 4 to 32 angles against the previous hard-coded angles,
+// and check the accuracy of both against a double precision calculation and the angles of degenerate joints
+bool benchmarkJointAngles() {
+    std::vector<k4abt_body_t> bodies;
+    makeBenchmarkBodies(bodies);
+
+    printf("Joint angles, %d bodies, %d frames:\n", ANGLE_BENCHMARK_BODIES, ANGLE_BENCHMARK_FRAMES);
+
+    std::vector<float> previousAngles(bodies.size() * 4);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(int frame = 0; frame < ANGLE_BENCHMARK_FRAMES; frame++) {
+        for(size_t i = 0; i < bodies.size(); i++) {
+            const k4abt_joint_t* joints = bodies[i].skeleton.joints;
+            previousAngles[4 * i + 0] = previousThreePointsToAngle(joints[K4ABT_JOINT_WRIST_LEFT].position, joints[K4ABT_JOINT_ELBOW_LEFT].position,
+                                                                   joints[K4ABT_JOINT_SHOULDER_LEFT].position);
+            previousAngles[4 * i + 1] = previousThreePointsToAngle(joints[K4ABT_JOINT_WRIST_RIGHT].position, joints[K4ABT_JOINT_ELBOW_RIGHT].position,
+                                                                   joints[K4ABT_JOINT_SHOULDER_RIGHT].position);
+            previousAngles[4 * i + 2] = previousThreePointsToAngle(joints[K4ABT_JOINT_HIP_LEFT].position, joints[K4ABT_JOINT_KNEE_LEFT].position,
+                                                                   joints[K4ABT_JOINT_ANKLE_LEFT].position);
+            previousAngles[4 * i + 3] = previousThreePointsToAngle(joints[K4ABT_JOINT_HIP_RIGHT].position, joints[K4ABT_JOINT_KNEE_RIGHT].position,
+                                                                   joints[K4ABT_JOINT_ANKLE_RIGHT].position);
+        }
+    }
+    double previousUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count() / ANGLE_BENCHMARK_FRAMES;
+    printf("  Previous 4 angles: %.3f us/frame, max error %g degrees\n", previousUs, maxAngleError(bodies, previousAngles.data(), 4));
+
+    // Angles of the sample config file, repeated to fill larger tables
+    const JointAngleDefinition definitions[] = {
+        {"Left Elbow", {K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_SHOULDER_LEFT}},
+        {"Right Elbow", {K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT}},
+        {"Left Knee", {K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT}},
+        {"Right Knee", {K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT}},
+        {"Left Shoulder", {K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_HIP_LEFT}},
+        {"Right Shoulder", {K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_HIP_RIGHT}},
+        {"Left Shoulder Abduction", {K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_CLAVICLE_LEFT}},
+        {"Right Shoulder Abduction", {K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_CLAVICLE_RIGHT}},
+        {"Left Wrist", {K4ABT_JOINT_HAND_LEFT, K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_ELBOW_LEFT}},
+        {"Right Wrist", {K4ABT_JOINT_HAND_RIGHT, K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_ELBOW_RIGHT}},
+        {"Neck", {K4ABT_JOINT_HEAD, K4ABT_JOINT_NECK, K4ABT_JOINT_SPINE_CHEST}},
+        {"Trunk", {K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS}},
+        {"Left Hip", {K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT}},
+        {"Right Hip", {K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT}},
+        {"Left Ankle", {K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT, K4ABT_JOINT_FOOT_LEFT}},
+        {"Right Ankle", {K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT, K4ABT_JOINT_FOOT_RIGHT}}
+    };
+    const size_t definitionCount = sizeof(definitions) / sizeof(definitions[0]);
+    const size_t angleCounts[] = {4, 8, 16, 32};
+
+    bool matches = true;
+    for(size_t angleCount : angleCounts) {
+        JointAngleTable table;
+        table.Clear();
+        for(size_t i = 0; i < angleCount; i++) {
+            table.Add(definitions[i % definitionCount]);
+        }
+
+        JointAngleCalculator calculator(table);
+        startTime = std::chrono::high_resolution_clock::now();
+        for(int frame = 0; frame < ANGLE_BENCHMARK_FRAMES; frame++) {
+            calculator.Compute(bodies.data(), bodies.size());
+        }
+        double tableUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count() / ANGLE_BENCHMARK_FRAMES;
+        // The first four angles are the default ones
+        double maxError = maxAngleError(bodies, calculator.Angles(0), angleCount);
+        printf("  Table, %zu angles: %.3f us/frame, %.1f ns/angle, max error %g degrees\n", angleCount, tableUs,
+               tableUs * 1000.0 / (angleCount * bodies.size()), maxError);
+        if(!(maxError <= ANGLE_BENCHMARK_TOLERANCE)) {
+            printf("  Table with %zu angles is not accurate enough!\n", angleCount);
+            matches = false;
+        }
+    }
+
+    matches = checkDegenerateAngles() && matches;
+    return matches;
+}
+
+bool RunBenchmark() {
+    const BenchmarkResolution resolutions[] = {
+        {"NFOV unbinned", 640, 576},
+        {"WFOV binned", 512, 512},
+        {"WFOV unbinned", 1024, 1024}
+    };
+    const PointCloudKernel kernels[] = {PointCloudKernel::Scalar, PointCloudKernel::Sse2, PointCloudKernel::Avx2};
+    const float defaultColor[4] = {0.8f, 0.8f, 0.8f, 0.6f};
+
+    // Colors of the two bodies; every other body index is white
+    std::vector<Color> bodyIndexColors(256);
+    bodyIndexColors[0] = g_bodyColors[1];
+    bodyIndexColors[1] = g_bodyColors[2];
+
+    // Say which parts of the builders are vectorized, so their timings are read for what they measure
+    printf("SSE2 and AVX2 builders: SIMD position conversion and depth test, per vertex stores and compaction\n");
+
+    bool matches = true;
+    for(const BenchmarkResolution& resolution : resolutions) {
+        int width = resolution.Width;
+        int height = resolution.Height;
+
+        std::vector<int16_t> pointCloud;
+        std::vector<uint8_t> bodyIndexMap;
+        makeBenchmarkFrame(width, height, pointCloud, bodyIndexMap);
+
+        std::vector<Color> pointCloudColors((size_t) width * height);
+        for(size_t i = 0; i < pointCloudColors.size(); i++) {
+            pointCloudColors[i] = bodyIndexColors[bodyIndexMap[i]];
+        }
+
+        printf("Point cloud vertex builder, %s (%dx%d), %d frames:\n", resolution.Name, width, height, BENCHMARK_FRAMES);
+
+        std::vector<PointCloudVertex> previousVertices;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for(int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+            buildPreviousVertices(pointCloud.data(), pointCloudColors, width, height, previousVertices);
+        }
+        double previousMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / BENCHMARK_FRAMES;
+        printf("  Previous loop: %.3f ms/frame, %zu points\n", previousMs, previousVertices.size());
+
+        std::vector<PointCloudVertex> vertices((size_t) width * height);
+        for(PointCloudKernel kernel : kernels) {
+            const char* kernelName = Visualization::GetPointCloudKernelName(kernel);
+            if(!Visualization::IsPointCloudKernelSupported(kernel)) {
+                printf("  %s: not supported by this processor\n", kernelName);
+                continue;
+            }
+
+            uint32_t count = 0;
+            linmath::vec4 palette[256];
+            startTime = std::chrono::high_resolution_clock::now();
+            for(int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+                // The palette is blended every frame, like Window3dWrapper does
+                for(int i = 0; i < 256; i++) {
+                    memcpy(palette[i], defaultColor, sizeof(palette[i]));
+                    blendBenchmarkColor(palette[i], bodyIndexColors[i]);
+                }
+                count = Visualization::BuildPointCloudVertices(kernel, pointCloud.data(), bodyIndexMap.data(), palette, defaultColor,
+                                                               width, height, vertices.data());
+            }
+            double kernelMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / BENCHMARK_FRAMES;
+            printf("  %s: %.3f ms/frame (%.2fx)\n", kernelName, kernelMs, kernelMs > 0 ? previousMs / kernelMs : 0.0);
+
+            // Every implementation has to produce exactly the vertices of the previous loop
+            if(count != previousVertices.size() ||
+               memcmp(vertices.data(), previousVertices.data(), count * sizeof(PointCloudVertex)) != 0) {
+                printf("  %s output does not match the previous loop!\n", kernelName);
+                matches = false;
+            }
+        }
+
+        // Packed vertices keep the millimeter positions, so they match the previous loop before scaling to meters
+        uint32_t packedPalette[256];
+        std::vector<PackedPointCloudVertex> packedVertices((size_t) width * height);
+        uint32_t packedCount = 0;
+        startTime = std::chrono::high_resolution_clock::now();
+        for(int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+            for(int i = 0; i < 256; i++) {
+                float color[4];
+                memcpy(color, defaultColor, sizeof(color));
+                blendBenchmarkColor(color, bodyIndexColors[i]);
+                packedPalette[i] = Visualization::PackPointCloudColor(color);
+            }
+            packedCount = Visualization::BuildPackedPointCloudVertices(pointCloud.data(), bodyIndexMap.data(), packedPalette,
+                                                                       Visualization::PackPointCloudColor(defaultColor),
+                                                                       width, height, packedVertices.data());
+        }
+        double packedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() / BENCHMARK_FRAMES;
+        printf("  Packed: %.3f ms/frame (%.2fx), upload %.1f MB/frame instead of %.1f MB\n", packedMs, packedMs > 0 ? previousMs / packedMs : 0.0,
+               packedCount * sizeof(PackedPointCloudVertex) / 1e6, previousVertices.size() * sizeof(PointCloudVertex) / 1e6);
+
+        bool packedMatches = packedCount == previousVertices.size();
+        for(uint32_t i = 0; packedMatches && i < packedCount; i++) {
+            for(int k = 0; k < 3; k++) {
+                packedMatches = packedMatches && packedVertices[i].Position[k] * 0.001f == previousVertices[i].Position[k];
+            }
+            packedMatches = packedMatches && packedVertices[i].PixelLocation[0] == previousVertices[i].PixelLocation[0] &&
+                            packedVertices[i].PixelLocation[1] == previousVertices[i].PixelLocation[1];
+        }
+        if(!packedMatches) {
+            printf("  Packed output does not match the previous loop!\n");
+            matches = false;
+        }
+    }
+
+    matches = benchmarkJointAngles() && matches;
+    return matches;
+}
@@ -16,6 +16,8 @@
 #include "imgui_internal.h"
 
 #include "3DViewer.h"
+#include "SkeletonOutput.h"
+#include "SyntheticCapture.h"
 
 // Print command-line argument usage to the command line
 void PrintUsage() {
@@ -27,11 +29,59 @@ void PrintUsage() {
     printf("      CPU - Use the CPU only mode. It runs on machines without a GPU but it will be much slower\n");
     printf("      OFFLINE - Play a specified file. Does not require Kinect device\n");
     printf("      OUTPUT - Write angle information to a specified file in CSV format\n");
+    printf("      HEADLESS - Process an OFFLINE file or SYNTHETIC session without opening any windows. Also accepted as --headless\n");
+    printf("      BATCH - Process every recording in a directory, wildcard pattern or manifest file without windows.\n");
+    printf("              Each output is written next to its recording, or in the directory given with OUTPUT\n");
+    printf("      JOBS=N - Number of recordings processed at the same time in BATCH mode (default 1)\n");
+    printf("      TIMESTAMPS - Add raw device and system timestamp columns to CSV output\n");
+    printf("      KINEMATICS - Add velocity and acceleration columns of every angle and joint to CSV output, from device timestamps.\n");
+    printf("                   With BINARY they are calculated by EXPORT_CSV instead\n");
+    printf("      FILTER=TYPE - Filter joint positions before angles and velocities are written: NONE (default), ONE_EURO, KALMAN\n");
+    printf("                    or SAVITZKY_GOLAY. With BINARY the skeleton file is unfiltered and EXPORT_CSV applies the filter\n");
+    printf("      SMOOTHING=X - Smoothing factor of FILTER from 0 (least) to 1 (most) (default 0.5)\n");
+    printf("      FILTER_LOOKAHEAD=N - Future frames used by FILTER=SAVITZKY_GOLAY, 0 to %d. Rows are written N frames late (default 2)\n", JOINT_FILTER_MAX_LOOKAHEAD);
+    printf("      RAW - Also write the unfiltered angles and joint positions to CSV output when FILTER is used\n");
+    printf("      TRACKER_SMOOTHING=X - Temporal smoothing of the body tracker from 0 to 1\n");
+    printf("                            (default 1 for OFFLINE files, the body tracking SDK default for devices)\n");
+    printf("      BINARY - Write skeletons to OUTPUT in the compact binary skeleton format instead of CSV, with at most %u angles\n", SKELETON_ANGLE_COUNT);
+    printf("      EXPORT_CSV - Convert a specified binary skeleton file to CSV, written to OUTPUT or next to the input file.\n");
+    printf("                   Writes the stored angles, or calculates the angles of ANGLES from the joints\n");
+    printf("      FRAMES=FIRST-LAST - Only export frames FIRST to LAST with EXPORT_CSV\n");
+    printf("      BODY_ID=N - Only export the body with ID N with EXPORT_CSV\n");
+    printf("      ANGLES - Write the joint angles defined in a specified config file instead of the elbow and knee angles.\n");
+    printf("               Each line is Name, FIRST_JOINT, VERTEX_JOINT, LAST_JOINT, e.g. Left Elbow, WRIST_LEFT, ELBOW_LEFT, SHOULDER_LEFT\n");
+    printf("      BENCHMARK - Time the point cloud vertex builders and packed vertex builder on generated NFOV and WFOV frames\n");
+    printf("                  and the joint angle calculator with 4 to 32 angles, and check their output\n");
+    printf("      CPU_POINT_CLOUD - Build the 3D viewer's point cloud on the CPU instead of unprojecting the depth frame on the GPU\n");
+    printf("      POINT_CLOUD=MODE - Points drawn by the 3D viewer: FULL (default), STRIDE, VOXEL, FOREGROUND (bodies only)\n");
+    printf("                         or NONE (skeletons only)\n");
+    printf("      POINT_STRIDE=N - Draw every Nth pixel of every Nth row with POINT_CLOUD=STRIDE (default 2)\n");
+    printf("      VOXEL_SIZE=N - Draw one point per N millimeter cube with POINT_CLOUD=VOXEL (default 20)\n");
+    printf("      RENDER_FPS=N - Target frame rate of the 3D viewer and data window, or 0 for no limit (default 30).\n");
+    printf("                     Tracking and output do not wait for rendering\n");
+    printf("      SYNTHETIC - Generate depth frames of moving bodies with scripted skeletons instead of using a device or file.\n");
+    printf("                  Does not require Kinect device, the body tracking SDK or a GPU\n");
+    printf("      BODIES=N - Number of bodies in SYNTHETIC mode, 0 to %d (default 2)\n", SYNTHETIC_MAX_BODIES);
+    printf("      SYNTHETIC_FPS=N - Frame rate of the device timestamps in SYNTHETIC mode (default 30)\n");
+    printf("      SYNTHETIC_FRAMES=N - Number of frames generated in SYNTHETIC mode, or 0 to run until closed (default 900)\n");
+    printf("      FRAME_COUNT_FILE - Write the number of processed frames of an OFFLINE file or SYNTHETIC session to a specified file\n");
+    printf("                         as a single number. BATCH uses it to collect the frame counts of its recordings\n");
+    printf("      COMPARE - Compare the CSV output of an OFFLINE file or SYNTHETIC session with a specified expected CSV file\n");
+    printf("                after it is written, and exit with an error if they differ\n");
     printf("e.g.   AzureKinectDataCollection.exe WFOV_BINNED CPU\n");
     printf("e.g.   AzureKinectDataCollection.exe CPU\n");
     printf("e.g.   AzureKinectDataCollection.exe WFOV_BINNED\n");
     printf("e.g.   AzureKinectDataCollection.exe OFFLINE MyFile.mkv\n");
     printf("e.g.   AzureKinectDataCollection.exe OUTPUT output.csv\n");
+    printf("e.g.   AzureKinectDataCollection.exe CPU HEADLESS OFFLINE MyFile.mkv\n");
+    printf("e.g.   AzureKinectDataCollection.exe BATCH recordings\\*.mkv JOBS=4 OUTPUT results\n");
+    printf("e.g.   AzureKinectDataCollection.exe BINARY OFFLINE MyFile.mkv OUTPUT output.skel\n");
+    printf("e.g.   AzureKinectDataCollection.exe EXPORT_CSV output.skel OUTPUT output.csv\n");
+    printf("e.g.   AzureKinectDataCollection.exe EXPORT_CSV output.skel FRAMES=300-600 BODY_ID=1\n");
+    printf("e.g.   AzureKinectDataCollection.exe OFFLINE MyFile.mkv ANGLES JointAngles.txt\n");
+    printf("e.g.   AzureKinectDataCollection.exe OFFLINE MyFile.mkv TRACKER_SMOOTHING=0 FILTER=ONE_EURO SMOOTHING=0.3 RAW\n");
+    printf("e.g.   AzureKinectDataCollection.exe SYNTHETIC HEADLESS BODIES=3 SYNTHETIC_FRAMES=3000 OUTPUT synthetic.csv\n");
+    printf("e.g.   AzureKinectDataCollection.exe SYNTHETIC HEADLESS OUTPUT synthetic.csv COMPARE expected.csv\n");
 }
 
 // Print 3D viewer window controls to the command line
@@ -60,15 +110,27 @@ bool fileExists(std::string filename) {
     return isOpen;
 }
 
-// Get the first unused indexed output filename
-std::string getIndexedFilename() {
+SkeletonCsvOptions GetSkeletonCsvOptions(const InputSettings& inputSettings) {
+    SkeletonCsvOptions options;
+    options.Angles = inputSettings.Angles;
+    options.Filter.Type = inputSettings.Filter;
+    options.Filter.Smoothing = inputSettings.Smoothing;
+    options.Filter.Lookahead = inputSettings.FilterLookahead;
+    options.Raw = inputSettings.RawOutput;
+    options.Kinematics = inputSettings.Kinematics;
+    options.Timestamps = inputSettings.Timestamps;
+    return options;
+}
+
+// Get the first unused indexed output filename with the passed extension
+std::string getIndexedFilename(const std::string& extension) {
     int fileIndex = 1;
-    std::string curFilename = "output1.csv";
+    std::string curFilename = "output1" + extension;
 
     // Run until an unused indexed output filename is found or the file index is too high
     while(fileExists(curFilename) && fileIndex < INT_MAX) {
         fileIndex++;
-        curFilename = "output" + std::to_string(fileIndex) + ".csv";
+        curFilename = "output" + std::to_string(fileIndex) + extension;
     }
 
     // Check if the maximum number of numbered output files has been reached
@@ -95,7 +157,17 @@ int startupGUIWidgets(InputSettings& inputSettings, std::string& errorText) {
     static bool offline_mode = false;
     static bool run_for_time = false;
     static bool empty_lines = false;
+    static bool binary_output = false;
+    static bool timestamps = false;
+    static bool kinematics = false;
+    const char* joint_filters[] = {"None", "One Euro", "Kalman", "Savitzky-Golay"};
+    static int joint_filter_index = 0; // Order of JointFilterType, default is no filter
+    static float smoothing = 0.5f;
     static float run_time = 0.0f;
+    const char* point_cloud_modes[] = {"Full", "Every Nth pixel", "Voxel grid", "Bodies only", "Skeletons only"};
+    static int point_cloud_mode_index = 0; // Order of Visualization::PointCloudDecimation, default is full
+    static int point_stride = 2;
+    static int voxel_size = 20;
     static char input_filename[128] = "";
     static char output_filename[128] = "";
 
@@ -115,6 +187,16 @@ int startupGUIWidgets(InputSettings& inputSettings, std::string& errorText) {
     ImGui::Checkbox("Collect data from file", &offline_mode);
     ImGui::Checkbox("Run for set time", &run_for_time);
     ImGui::Checkbox("Record lines without body data", &empty_lines);
+    ImGui::Checkbox("Record device and system timestamps", &timestamps);
+    ImGui::Checkbox("Record joint and angle velocity and acceleration", &kinematics);
+    ImGui::Combo("Joint filter", &joint_filter_index, joint_filters, IM_ARRAYSIZE(joint_filters));
+    ImGui::SliderFloat("Filter smoothing", &smoothing, 0.0f, 1.0f);
+    if(ImGui::Checkbox("Write binary skeleton file", &binary_output)) {
+        // Switch the default output filename to the extension of the chosen format
+        if(inputSettings.OutputFileName == getIndexedFilename(binary_output ? ".csv" : SKELETON_FILE_EXTENSION)) {
+            inputSettings.OutputFileName = getIndexedFilename(binary_output ? SKELETON_FILE_EXTENSION : ".csv");
+        }
+    }
 
     // Disable seconds to run text input if not running for a set time
     if(!run_for_time) {
@@ -127,6 +209,29 @@ int startupGUIWidgets(InputSettings& inputSettings, std::string& errorText) {
         ImGui::PopStyleVar();
     }
 
+    // Point cloud decimation, with the stride and voxel size only enabled for their modes
+    ImGui::Combo("3D viewer point cloud", &point_cloud_mode_index, point_cloud_modes, IM_ARRAYSIZE(point_cloud_modes));
+    bool stride_mode = point_cloud_mode_index == (int) Visualization::PointCloudDecimation::Stride;
+    if(!stride_mode) {
+        ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+        ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+    }
+    ImGui::InputInt("Point stride (pixels)", &point_stride);
+    if(!stride_mode) {
+        ImGui::PopItemFlag();
+        ImGui::PopStyleVar();
+    }
+    bool voxel_mode = point_cloud_mode_index == (int) Visualization::PointCloudDecimation::VoxelGrid;
+    if(!voxel_mode) {
+        ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+        ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+    }
+    ImGui::InputInt("Voxel size (mm)", &voxel_size);
+    if(!voxel_mode) {
+        ImGui::PopItemFlag();
+        ImGui::PopStyleVar();
+    }
+
     // Disable input filename text input if not collecting data from file
     if(!offline_mode) {
         ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
@@ -161,6 +266,14 @@ int startupGUIWidgets(InputSettings& inputSettings, std::string& errorText) {
         inputSettings.Offline = offline_mode;
         inputSettings.InputFileName = input_filename;
         inputSettings.EmptyLines = empty_lines;
+        inputSettings.BinaryOutput = binary_output;
+        inputSettings.Timestamps = timestamps;
+        inputSettings.Kinematics = kinematics;
+        inputSettings.Filter = (JointFilterType) joint_filter_index;
+        inputSettings.Smoothing = smoothing;
+        inputSettings.PointCloudMode = (Visualization::PointCloudDecimation) point_cloud_mode_index;
+        inputSettings.PointCloudStride = point_stride;
+        inputSettings.VoxelSize = voxel_size;
 
         if(run_for_time) {
             inputSettings.RunTime = (int) (run_time * 1000.0f);
@@ -200,6 +313,16 @@ int startupGUIWidgets(InputSettings& inputSettings, std::string& errorText) {
             startCollection = 0;
         }
 
+        if(stride_mode && point_stride < 1) {
+            errorText += "ERROR: Point stride must be at least 1\n";
+            startCollection = 0;
+        }
+
+        if(voxel_mode && voxel_size < 1) {
+            errorText += "ERROR: Voxel size must be at least 1 mm\n";
+            startCollection = 0;
+        }
+
         if(offline_mode && !fileExists(inputSettings.InputFileName)) {
             errorText += "ERROR: Input file \"" + inputSettings.InputFileName + "\" does not exist\n";
             startCollection = 0;
@@ -244,7 +367,7 @@ bool runStartupGUI(InputSettings& inputSettings) {
 
     std::string errorText = "";
 
-    inputSettings.OutputFileName = getIndexedFilename();
+    inputSettings.OutputFileName = getIndexedFilename(".csv");
 
     // Correct font scaling
     if(!glfwInit()) {
@@ -328,6 +451,7 @@ bool runStartupGUI(InputSettings& inputSettings) {
 bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettings) {
     for(int i = 1; i < argc; i++) {
         std::string inputArg(argv[i]);
+        int argStart = i;
         if(inputArg == std::string("NFOV_BINNED")) {
             inputSettings.DepthCameraMode = K4A_DEPTH_MODE_NFOV_2X2BINNED;
         }
@@ -367,6 +491,172 @@ bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettin
                 return false;
             }
         }
+        else if(inputArg == std::string("BATCH")) {
+            inputSettings.Batch = true;
+            if(i < argc - 1) {
+                // Take the next argument after BATCH as the directory, pattern or manifest of recordings
+                inputSettings.BatchInput = argv[i + 1];
+                i++;
+            }
+            else {
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 5) == std::string("JOBS=")) {
+            inputSettings.BatchJobs = stoi(inputArg.substr(5, inputArg.size() - 5));
+            if(inputSettings.BatchJobs < 1) {
+                printf("JOBS must be at least 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg == std::string("TIMESTAMPS")) {
+            inputSettings.Timestamps = true;
+        }
+        else if(inputArg == std::string("KINEMATICS")) {
+            inputSettings.Kinematics = true;
+        }
+        else if(inputArg.substr(0, 7) == std::string("FILTER=")) {
+            std::string filter = inputArg.substr(7, inputArg.size() - 7);
+            if(filter == std::string("NONE")) {
+                inputSettings.Filter = JointFilterType::None;
+            }
+            else if(filter == std::string("ONE_EURO")) {
+                inputSettings.Filter = JointFilterType::OneEuro;
+            }
+            else if(filter == std::string("KALMAN")) {
+                inputSettings.Filter = JointFilterType::Kalman;
+            }
+            else if(filter == std::string("SAVITZKY_GOLAY")) {
+                inputSettings.Filter = JointFilterType::SavitzkyGolay;
+            }
+            else {
+                printf("FILTER must be NONE, ONE_EURO, KALMAN or SAVITZKY_GOLAY.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 10) == std::string("SMOOTHING=")) {
+            inputSettings.Smoothing = stof(inputArg.substr(10, inputArg.size() - 10));
+            if(inputSettings.Smoothing < 0.0f || inputSettings.Smoothing > 1.0f) {
+                printf("SMOOTHING must be between 0 and 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 17) == std::string("FILTER_LOOKAHEAD=")) {
+            inputSettings.FilterLookahead = stoi(inputArg.substr(17, inputArg.size() - 17));
+            if(inputSettings.FilterLookahead < 0 || inputSettings.FilterLookahead > JOINT_FILTER_MAX_LOOKAHEAD) {
+                printf("FILTER_LOOKAHEAD must be between 0 and %d.\n", JOINT_FILTER_MAX_LOOKAHEAD);
+                return false;
+            }
+        }
+        else if(inputArg == std::string("RAW")) {
+            inputSettings.RawOutput = true;
+        }
+        else if(inputArg.substr(0, 18) == std::string("TRACKER_SMOOTHING=")) {
+            inputSettings.TrackerSmoothing = stof(inputArg.substr(18, inputArg.size() - 18));
+            if(inputSettings.TrackerSmoothing < 0.0f || inputSettings.TrackerSmoothing > 1.0f) {
+                printf("TRACKER_SMOOTHING must be between 0 and 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg == std::string("BINARY")) {
+            inputSettings.BinaryOutput = true;
+        }
+        else if(inputArg == std::string("EXPORT_CSV")) {
+            inputSettings.ExportCsv = true;
+            if(i < argc - 1) {
+                // Take the next argument after EXPORT_CSV as the skeleton file name
+                inputSettings.InputFileName = argv[i + 1];
+                i++;
+            }
+            else {
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 7) == std::string("FRAMES=")) {
+            std::string frames = inputArg.substr(7, inputArg.size() - 7);
+            size_t separator = frames.find('-');
+            if(separator == std::string::npos) {
+                return false;
+            }
+
+            inputSettings.ExportFirstFrame = (uint32_t) stoul(frames.substr(0, separator));
+            inputSettings.ExportLastFrame = (uint32_t) stoul(frames.substr(separator + 1));
+        }
+        else if(inputArg.substr(0, 8) == std::string("BODY_ID=")) {
+            inputSettings.ExportBodyId = (uint32_t) stoul(inputArg.substr(8, inputArg.size() - 8));
+        }
+        else if(inputArg == std::string("BENCHMARK")) {
+            inputSettings.Benchmark = true;
+        }
+        else if(inputArg == std::string("CPU_POINT_CLOUD")) {
+            inputSettings.CpuPointCloud = true;
+        }
+        else if(inputArg.substr(0, 12) == std::string("POINT_CLOUD=")) {
+            std::string mode = inputArg.substr(12, inputArg.size() - 12);
+            if(mode == std::string("FULL")) {
+                inputSettings.PointCloudMode = Visualization::PointCloudDecimation::Full;
+            }
+            else if(mode == std::string("STRIDE")) {
+                inputSettings.PointCloudMode = Visualization::PointCloudDecimation::Stride;
+            }
+            else if(mode == std::string("VOXEL")) {
+                inputSettings.PointCloudMode = Visualization::PointCloudDecimation::VoxelGrid;
+            }
+            else if(mode == std::string("FOREGROUND")) {
+                inputSettings.PointCloudMode = Visualization::PointCloudDecimation::Foreground;
+            }
+            else if(mode == std::string("NONE")) {
+                inputSettings.PointCloudMode = Visualization::PointCloudDecimation::SkeletonOnly;
+            }
+            else {
+                printf("POINT_CLOUD must be FULL, STRIDE, VOXEL, FOREGROUND or NONE.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 13) == std::string("POINT_STRIDE=")) {
+            inputSettings.PointCloudStride = stoi(inputArg.substr(13, inputArg.size() - 13));
+            if(inputSettings.PointCloudStride < 1) {
+                printf("POINT_STRIDE must be at least 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 11) == std::string("VOXEL_SIZE=")) {
+            inputSettings.VoxelSize = stoi(inputArg.substr(11, inputArg.size() - 11));
+            if(inputSettings.VoxelSize < 1) {
+                printf("VOXEL_SIZE must be at least 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 11) == std::string("RENDER_FPS=")) {
+            inputSettings.RenderRate = stoi(inputArg.substr(11, inputArg.size() - 11));
+            if(inputSettings.RenderRate < 0) {
+                printf("RENDER_FPS must be at least 0.\n");
+                return false;
+            }
+        }
+        else if(inputArg == std::string("SYNTHETIC")) {
+            inputSettings.Synthetic = true;
+        }
+        else if(inputArg.substr(0, 7) == std::string("BODIES=")) {
+            inputSettings.SyntheticBodies = stoi(inputArg.substr(7, inputArg.size() - 7));
+            if(inputSettings.SyntheticBodies < 0 || inputSettings.SyntheticBodies > SYNTHETIC_MAX_BODIES) {
+                printf("BODIES must be between 0 and %d.\n", SYNTHETIC_MAX_BODIES);
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 14) == std::string("SYNTHETIC_FPS=")) {
+            inputSettings.SyntheticFrameRate = stoi(inputArg.substr(14, inputArg.size() - 14));
+            if(inputSettings.SyntheticFrameRate < 1) {
+                printf("SYNTHETIC_FPS must be at least 1.\n");
+                return false;
+            }
+        }
+        else if(inputArg.substr(0, 17) == std::string("SYNTHETIC_FRAMES=")) {
+            inputSettings.SyntheticFrames = (uint32_t) stoul(inputArg.substr(17, inputArg.size() - 17));
+        }
+        else if(inputArg == std::string("HEADLESS") || inputArg == std::string("--headless")) {
+            inputSettings.Headless = true;
+        }
         else if(inputArg == std::string("OUTPUT")) {
             if(i < argc - 1) {
                 // Take the next argument after OUTPUT as output file name
@@ -377,15 +667,142 @@ bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettin
                 return false;
             }
         }
+        else if(inputArg == std::string("ANGLES")) {
+            if(i < argc - 1) {
+                // Take the next argument after ANGLES as the angle config file name
+                inputSettings.AnglesFileName = argv[i + 1];
+                i++;
+            }
+            else {
+                return false;
+            }
+        }
+        else if(inputArg == std::string("FRAME_COUNT_FILE")) {
+            if(i < argc - 1) {
+                // Take the next argument after FRAME_COUNT_FILE as the frame count file name
+                inputSettings.FrameCountFileName = argv[i + 1];
+                i++;
+            }
+            else {
+                return false;
+            }
+        }
+        else if(inputArg == std::string("COMPARE")) {
+            if(i < argc - 1) {
+                // Take the next argument after COMPARE as the expected CSV file name
+                inputSettings.CompareFileName = argv[i + 1];
+                i++;
+            }
+            else {
+                return false;
+            }
+        }
         else {
             printf("Error command not understood: %s\n", inputArg.c_str());
             return false;
         }
+
+        // Keep every option that does not choose the batch itself, with its value, for the process of each recording
+        if(inputArg != std::string("BATCH") && inputArg.substr(0, 5) != std::string("JOBS=") && inputArg != std::string("OUTPUT") &&
+           inputArg != std::string("HEADLESS") && inputArg != std::string("--headless") && inputArg != std::string("FRAME_COUNT_FILE")) {
+            for(int k = argStart; k <= i; k++) {
+                inputSettings.BatchArguments.push_back(argv[k]);
+            }
+        }
+    }
+
+    // The benchmark does not read or write any files
+    if(inputSettings.Benchmark) {
+        return true;
+    }
+
+    // Replace the default angles with the ones of the config file
+    if(inputSettings.AnglesFileName != "") {
+        std::string errorText;
+        if(!inputSettings.Angles.Load(inputSettings.AnglesFileName, errorText)) {
+            printf("%s\n", errorText.c_str());
+            return false;
+        }
+    }
+
+    // Binary files keep every angle of the table in their records, so their angles can be exported without calculating them again
+    std::string angleErrorText;
+    if(inputSettings.BinaryOutput && !CanStoreSkeletonAngles(inputSettings.Angles, angleErrorText)) {
+        printf("%s\n", angleErrorText.c_str());
+        return false;
+    }
+
+    // Export mode writes the CSV file next to the skeleton file unless an output file was given
+    if(inputSettings.ExportCsv) {
+        if(inputSettings.Offline || inputSettings.Batch) {
+            printf("EXPORT_CSV cannot be combined with OFFLINE or BATCH.\n");
+            return false;
+        }
+
+        if(inputSettings.OutputFileName == "") {
+            std::string baseName = inputSettings.InputFileName;
+            size_t extensionStart = baseName.find_last_of("./\\");
+            if(extensionStart != std::string::npos && baseName[extensionStart] == '.') {
+                baseName.erase(extensionStart);
+            }
+
+            inputSettings.OutputFileName = baseName + ".csv";
+        }
+
+        if(fileExists(inputSettings.OutputFileName)) {
+            printf("File %s already exists.\n", inputSettings.OutputFileName.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    // Batch mode names its own output files
+    if(inputSettings.Batch) {
+        if(inputSettings.Offline || inputSettings.Synthetic || inputSettings.CompareFileName != "" || inputSettings.FrameCountFileName != "") {
+            printf("BATCH cannot be combined with OFFLINE, SYNTHETIC, COMPARE or FRAME_COUNT_FILE.\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    if(inputSettings.Synthetic && inputSettings.Offline) {
+        printf("SYNTHETIC cannot be combined with OFFLINE.\n");
+        return false;
+    }
+
+    // Headless mode only supports sessions that do not need a device
+    if(inputSettings.Headless && !inputSettings.Offline && !inputSettings.Synthetic) {
+        printf("HEADLESS requires an OFFLINE input file or SYNTHETIC mode.\n");
+        return false;
+    }
+
+    // Only sessions of a file or synthetic frames end on their own and have a frame count to report
+    if(inputSettings.FrameCountFileName != "" && !inputSettings.Offline && !inputSettings.Synthetic) {
+        printf("FRAME_COUNT_FILE requires an OFFLINE input file or SYNTHETIC mode.\n");
+        return false;
+    }
+
+    // Comparisons need CSV output that only depends on the input
+    if(inputSettings.CompareFileName != "") {
+        if(!inputSettings.Offline && !inputSettings.Synthetic) {
+            printf("COMPARE requires an OFFLINE input file or SYNTHETIC mode.\n");
+            return false;
+        }
+        if(inputSettings.BinaryOutput || inputSettings.RunTime != -1) {
+            printf("COMPARE cannot be combined with BINARY or RUN_TIME.\n");
+            return false;
+        }
+        if(!fileExists(inputSettings.CompareFileName)) {
+            printf("File %s does not exist.\n", inputSettings.CompareFileName.c_str());
+            return false;
+        }
     }
 
     // Set output filename to default if not specified
     if(inputSettings.OutputFileName == "") {
-        inputSettings.OutputFileName = getIndexedFilename();
+        inputSettings.OutputFileName = getIndexedFilename(inputSettings.BinaryOutput ? SKELETON_FILE_EXTENSION : ".csv");
     }
     // Check if output file already exists
     else if(fileExists(inputSettings.OutputFileName)) {
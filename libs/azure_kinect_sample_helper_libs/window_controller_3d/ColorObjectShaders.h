@@ -32,6 +32,34 @@ static const char* const glslColorObjectVertexShader = GLSL_STRING(
 );  // GLSL_STRING
 
 
+// ************** Color Object Instanced Vertex Shader **************
+// Same as the color object vertex shader with the model matrix of each instance as a vertex attribute
+static const char* const glslColorObjectInstancedVertexShader = GLSL_STRING(
+
+    layout(location = 0) in vec3 vertexPosition;
+    layout(location = 1) in vec3 vertexNormal;
+    layout(location = 2) in vec4 vertexColor;
+    layout(location = 3) in mat4 instanceModel;
+
+    varying vec4 fragmentColor;
+    varying vec3 fragmentPosition;
+    varying vec3 fragmentNormal;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    void main()
+    {
+        fragmentColor = vertexColor;
+        fragmentPosition = vec3(instanceModel * vec4(vertexPosition, 1.0));
+        fragmentNormal = mat3(transpose(inverse(instanceModel))) * vertexNormal;
+
+        gl_Position = projection * view * instanceModel * vec4(vertexPosition, 1);
+    }
+
+);  // GLSL_STRING
+
+
 // ************** Color Object Fragment Shader **************
 static const char* const glslColorObjectFragmentShader = GLSL_STRING(
 
@@ -91,6 +91,10 @@ void CoordinateAxes::Create(GLFWwindow * window)
     m_viewIndex = glGetUniformLocation(m_shaderProgram, "view");
     m_projectionIndex = glGetUniformLocation(m_shaderProgram, "projection");
 
+    m_instancedShaderProgram = CreateShaderProgram(glslColorObjectInstancedVertexShader, glslColorObjectFragmentShader);
+    m_instancedViewIndex = glGetUniformLocation(m_instancedShaderProgram, "view");
+    m_instancedProjectionIndex = glGetUniformLocation(m_instancedShaderProgram, "projection");
+
     // **************** Generate Sphere VAO ****************
     glGenVertexArrays(1, &m_vertexArrayObject);
     glBindVertexArray(m_vertexArrayObject);
@@ -118,6 +122,10 @@ void CoordinateAxes::Create(GLFWwindow * window)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBufferObject);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STATIC_DRAW);
 
+    // Per-instance attributes for instanced rendering
+    glGenBuffers(1, &m_instanceBufferObject);
+    SetInstanceAttributes(m_instanceBufferObject);
+
     // **************** Unbind VAO ****************
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -134,6 +142,9 @@ void CoordinateAxes::Delete()
     m_initialized = false;
     glDeleteBuffers(1, &m_vertexBufferObject);
     glDeleteBuffers(1, &m_elementBufferObject);
+    glDeleteBuffers(1, &m_instanceBufferObject);
+    glDeleteProgram(m_instancedShaderProgram);
+    m_instanceCount = 0;
 
     glDeleteShader(m_vertexShader);
     glDeleteShader(m_fragmentShader);
@@ -171,6 +182,29 @@ void CoordinateAxes::Render(const linmath::vec3 p, const linmath::quaternion q)
     Render(model);
 }
 
+void CoordinateAxes::UpdateInstances(const ObjectInstance* instances, size_t count)
+{
+    UpdateInstanceBuffer(m_instanceBufferObject, instances, count);
+    m_instanceCount = static_cast<GLsizei>(count);
+}
+
+void CoordinateAxes::RenderInstances()
+{
+    if (m_instanceCount == 0)
+    {
+        return;
+    }
+
+    glUseProgram(m_instancedShaderProgram);
+
+    // Update view/projective matrices in shader; the model matrices are instance attributes
+    glUniformMatrix4fv(m_instancedViewIndex, 1, GL_FALSE, (const GLfloat*)m_view);
+    glUniformMatrix4fv(m_instancedProjectionIndex, 1, GL_FALSE, (const GLfloat*)m_projection);
+
+    glBindVertexArray(m_vertexArrayObject);
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_indices.size(), GL_UNSIGNED_INT, NULL, m_instanceCount);
+}
+
 void CoordinateAxes::BuildVertices()
 {
     // Cylinder is created along z axis and centered at origin.
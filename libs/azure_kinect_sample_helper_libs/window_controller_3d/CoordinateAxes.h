@@ -35,6 +35,10 @@ namespace Visualization
         void Render(const linmath::mat4x4 model);
         void Render(const linmath::vec3 p, const linmath::quaternion q);
 
+        // Instanced rendering: upload the model matrix of every set of axes once, then draw them all with one call
+        void UpdateInstances(const ObjectInstance* instances, size_t count);
+        void RenderInstances();
+
     private:
         void BuildVertices();
 
@@ -56,5 +60,12 @@ namespace Visualization
         GLuint m_modelIndex;
         GLuint m_viewIndex;
         GLuint m_projectionIndex;
+
+        // Instanced rendering objects
+        GLuint m_instancedShaderProgram = 0;
+        GLuint m_instanceBufferObject = 0;
+        GLuint m_instancedViewIndex = 0;
+        GLuint m_instancedProjectionIndex = 0;
+        GLsizei m_instanceCount = 0;
     };
 }
\ No newline at end of file
@@ -14,6 +14,8 @@ using namespace linmath;
 using namespace Visualization;
 
 static const int MIN_SECTOR_COUNT = 3;
+// Shortest cylinder an instance is computed for, in the units of the joint positions (meters)
+static const float MIN_MODEL_LENGTH = 1e-5f;
 
 Cylinder::Cylinder(float baseRadius, float height, int sectorCount)
     : m_baseRadius(baseRadius)
@@ -109,6 +111,10 @@ void Cylinder::Create(GLFWwindow * window)
     m_modelIndex = glGetUniformLocation(m_shaderProgram, "model");
     m_viewIndex = glGetUniformLocation(m_shaderProgram, "view");
     m_projectionIndex = glGetUniformLocation(m_shaderProgram, "projection");
+
+    m_instancedShaderProgram = CreateShaderProgram(glslMonoObjectInstancedVertexShader, glslMonoObjectFragmentShader);
+    m_instancedViewIndex = glGetUniformLocation(m_instancedShaderProgram, "view");
+    m_instancedProjectionIndex = glGetUniformLocation(m_instancedShaderProgram, "projection");
     m_colorIndex = glGetUniformLocation(m_shaderProgram, "color");
 
     // **************** Generate Sphere VAO ****************
@@ -134,6 +140,10 @@ void Cylinder::Create(GLFWwindow * window)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBufferObject);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STATIC_DRAW);
 
+    // Per-instance attributes for instanced rendering
+    glGenBuffers(1, &m_instanceBufferObject);
+    SetInstanceAttributes(m_instanceBufferObject);
+
     // **************** Unbind VAO ****************
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -150,6 +160,9 @@ void Cylinder::Delete()
     m_initialized = false;
     glDeleteBuffers(1, &m_vertexBufferObject);
     glDeleteBuffers(1, &m_elementBufferObject);
+    glDeleteBuffers(1, &m_instanceBufferObject);
+    glDeleteProgram(m_instancedShaderProgram);
+    m_instanceCount = 0;
 
     glDeleteShader(m_vertexShader);
     glDeleteShader(m_fragmentShader);
@@ -203,6 +216,34 @@ void Cylinder::Render(const linmath::vec3 start, const linmath::vec3 end, const
     Render(model, color);
 }
 
+bool Cylinder::ComputeModel(mat4x4 model, const vec3 start, const vec3 end)
+{
+    vec3 centralAxis;
+    vec3_sub(centralAxis, start, end);
+    float length = vec3_len(centralAxis);
+    if (!(length > MIN_MODEL_LENGTH))
+    {
+        return false;
+    }
+
+    vec3 centerPosition;
+    vec3_add(centerPosition, start, end);
+    vec3_scale(centerPosition, centerPosition, 0.5f);
+
+    mat4x4 translation, rotation, rotationTranslation;
+    mat4x4_translate(translation, centerPosition[0], centerPosition[1], centerPosition[2]);
+
+    vec3 zAxis;
+    vec3_set(zAxis, 0.f, 0.f, 1.f);
+
+    ComputeRotationBetweenVectors(rotation, zAxis, centralAxis);
+    mat4x4_mul(rotationTranslation, translation, rotation);
+
+    // Instances share the vertices, so the length is a scale along the cylinder axis instead of a new height
+    mat4x4_scale_aniso(model, rotationTranslation, 1.f, 1.f, length / m_height);
+    return true;
+}
+
 void Cylinder::ComputeRotationBetweenVectors(mat4x4 rotation, const vec3 v0, const vec3 v1)
 {
     vec3 u0;
@@ -243,6 +284,29 @@ void Cylinder::ComputeRotationBetweenVectors(mat4x4 rotation, const vec3 v0, con
     rotation[3][3] = 1.f;
 }
 
+void Cylinder::UpdateInstances(const ObjectInstance* instances, size_t count)
+{
+    UpdateInstanceBuffer(m_instanceBufferObject, instances, count);
+    m_instanceCount = static_cast<GLsizei>(count);
+}
+
+void Cylinder::RenderInstances()
+{
+    if (m_instanceCount == 0)
+    {
+        return;
+    }
+
+    glUseProgram(m_instancedShaderProgram);
+
+    // Update view/projective matrices in shader; the model matrices are instance attributes
+    glUniformMatrix4fv(m_instancedViewIndex, 1, GL_FALSE, (const GLfloat*)m_view);
+    glUniformMatrix4fv(m_instancedProjectionIndex, 1, GL_FALSE, (const GLfloat*)m_projection);
+
+    glBindVertexArray(m_vertexArrayObject);
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_indices.size(), GL_UNSIGNED_INT, NULL, m_instanceCount);
+}
+
 // build vertices of Cylinder with smooth shading using parametric equation
 // x = r * cos(v)
 // y = r * sin(v)
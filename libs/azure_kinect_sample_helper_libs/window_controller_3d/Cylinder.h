@@ -38,6 +38,14 @@ namespace Visualization
         void Render(const linmath::mat4x4 model, const linmath::vec4 color);
         void Render(const linmath::vec3 start, const linmath::vec3 end, const linmath::vec4 color);
 
+        // Instanced rendering: upload the model matrix and color of every cylinder once, then draw them all with one call
+        void UpdateInstances(const ObjectInstance* instances, size_t count);
+        void RenderInstances();
+
+        // Model matrix of a cylinder from start to end, for instanced rendering. Returns false without setting the matrix
+        // if start and end are too close to give the cylinder a direction, since its scale would make the matrix singular.
+        bool ComputeModel(linmath::mat4x4 model, const linmath::vec3 start, const linmath::vec3 end);
+
     private:
         void BuildVertices();
 
@@ -65,6 +73,13 @@ namespace Visualization
         GLuint m_viewIndex;
         GLuint m_projectionIndex;
 
+        // Instanced rendering objects
+        GLuint m_instancedShaderProgram = 0;
+        GLuint m_instanceBufferObject = 0;
+        GLuint m_instancedViewIndex = 0;
+        GLuint m_instancedProjectionIndex = 0;
+        GLsizei m_instanceCount = 0;
+
         GLuint m_colorIndex;
     };
 }
\ No newline at end of file
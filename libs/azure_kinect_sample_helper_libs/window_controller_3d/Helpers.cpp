@@ -6,9 +6,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 #include "GLFW/glfw3.h"
 
+#include "GlShaderDefs.h"
+
 //// ASSERT METHODS
 void FailedValidation(const char* message)
 {
@@ -79,3 +82,57 @@ void ValidateProgram(GLuint programIndex)
         Fail("Shader Error: %s", infoLog);
     }
 }
+
+
+GLuint CreateShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    const GLchar* vertexShaderSources[] = { glslShaderVersion, vertexShaderSource };
+    glShaderSource(vertexShader, 2, vertexShaderSources, NULL);
+    glCompileShader(vertexShader);
+    ValidateShader(vertexShader);
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    const GLchar* fragmentShaderSources[] = { glslShaderVersion, fragmentShaderSource };
+    glShaderSource(fragmentShader, 2, fragmentShaderSources, NULL);
+    glCompileShader(fragmentShader);
+    ValidateShader(fragmentShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    ValidateProgram(program);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+// Instanced rendering helpers
+void SetInstanceAttributes(GLuint instanceBufferObject)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+
+    // A mat4 attribute takes one location per column
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = 3 + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Visualization::ObjectInstance),
+            (void*)(offsetof(Visualization::ObjectInstance, Model) + column * sizeof(linmath::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(Visualization::ObjectInstance), (void*)offsetof(Visualization::ObjectInstance, Color));
+    glVertexAttribDivisor(7, 1);
+}
+
+void UpdateInstanceBuffer(GLuint instanceBufferObject, const Visualization::ObjectInstance* instances, size_t count)
+{
+    // Orphan the previous content, so the upload does not wait for draws that still use it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(Visualization::ObjectInstance), instances, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
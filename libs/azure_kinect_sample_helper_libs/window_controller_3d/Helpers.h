@@ -5,6 +5,8 @@
 
 #include "glad/glad.h"
 
+#include "WindowController3dTypes.h"
+
 void FailedValidation(const char* message);
 
 void Fail(const char* message, ...);
@@ -18,6 +20,17 @@ void ValidateShader(GLuint shaderIndex);
 
 void ValidateProgram(GLuint programIndex);
 
+// Compile and link a program from the sources of a vertex and a fragment shader. The shaders are deleted once linked.
+GLuint CreateShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+
+// Instanced rendering helpers
+// Point the instance attributes of the bound vertex array object at a buffer of Visualization::ObjectInstance:
+// the model matrix at locations 3 to 6 and the color at location 7, advancing once per instance
+void SetInstanceAttributes(GLuint instanceBufferObject);
+
+// Upload the instances to the instance buffer, replacing its previous content
+void UpdateInstanceBuffer(GLuint instanceBufferObject, const Visualization::ObjectInstance* instances, size_t count);
+
 #define RETURN_IF_GL_ERRORS  { bool glErr = false; while (glGetError() != GL_NO_ERROR) { glErr = true; } if (glErr) { return GPU_ERROR_FROM_API; } }
 
 #define UNINIT_IF_GL_ERRORS  { bool glErr = false; while (glGetError() != GL_NO_ERROR) { glErr = true; } if (glErr) { UnInitialize(); return GPU_ERROR_FROM_API; } }
\ No newline at end of file
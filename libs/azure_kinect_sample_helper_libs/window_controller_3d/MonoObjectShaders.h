@@ -32,6 +32,34 @@ static const char* const glslMonoObjectVertexShader = GLSL_STRING(
 );  // GLSL_STRING
 
 
+// ************** Mono Object Instanced Vertex Shader **************
+// Same as the mono object vertex shader with the model matrix and color of each instance as vertex attributes
+static const char* const glslMonoObjectInstancedVertexShader = GLSL_STRING(
+
+    layout(location = 0) in vec3 vertexPosition;
+    layout(location = 1) in vec3 vertexNormal;
+    layout(location = 3) in mat4 instanceModel;
+    layout(location = 7) in vec4 instanceColor;
+
+    varying vec4 fragmentColor;
+    varying vec3 fragmentPosition;
+    varying vec3 fragmentNormal;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    void main()
+    {
+        fragmentColor = instanceColor;
+        fragmentPosition = vec3(instanceModel * vec4(vertexPosition, 1.0));
+        fragmentNormal = mat3(transpose(inverse(instanceModel))) * vertexNormal;
+
+        gl_Position = projection * view * instanceModel * vec4(vertexPosition, 1);
+    }
+
+);  // GLSL_STRING
+
+
 // ************** Mono Object Fragment Shader **************
 static const char* const glslMonoObjectFragmentShader = GLSL_STRING(
 
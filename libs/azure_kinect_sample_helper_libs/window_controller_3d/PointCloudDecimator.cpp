@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "PointCloudDecimator.h"
+
+#include <cmath>
+
+using namespace Visualization;
+
+namespace
+{
+    const float MillimeterToMeter = 0.001f;
+
+    // Body index map value of pixels that are not part of a body
+    const uint8_t BodyIndexBackground = 255;
+
+    // Voxel coordinates are packed into 21 bits each, which covers +-1 km with 1 mm voxels
+    const uint64_t VoxelCoordinateMask = (1ull << 21) - 1;
+
+    inline void GetPositionInMeter(const PointCloudVertex& vertex, float& x, float& y, float& z)
+    {
+        x = vertex.Position[0];
+        y = vertex.Position[1];
+        z = vertex.Position[2];
+    }
+
+    inline void GetPositionInMeter(const PackedPointCloudVertex& vertex, float& x, float& y, float& z)
+    {
+        x = vertex.Position[0] * MillimeterToMeter;
+        y = vertex.Position[1] * MillimeterToMeter;
+        z = vertex.Position[2] * MillimeterToMeter;
+    }
+}
+
+void PointCloudDecimator::SetDecimation(PointCloudDecimation decimation, uint32_t stride, float voxelSize)
+{
+    m_decimation = decimation;
+    m_stride = stride > 0 ? stride : 1;
+    m_inverseVoxelSize = voxelSize > 0.f ? 1.f / voxelSize : 1.f;
+}
+
+uint32_t PointCloudDecimator::Decimate(PointCloudVertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width)
+{
+    return DecimateVertices(vertices, numPoints, bodyIndexMap, width);
+}
+
+uint32_t PointCloudDecimator::Decimate(PackedPointCloudVertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width)
+{
+    return DecimateVertices(vertices, numPoints, bodyIndexMap, width);
+}
+
+template<typename Vertex>
+uint32_t PointCloudDecimator::DecimateVertices(Vertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width)
+{
+    uint32_t count = 0;
+    switch (m_decimation)
+    {
+    case PointCloudDecimation::Stride:
+        for (uint32_t i = 0; i < numPoints; i++)
+        {
+            if (vertices[i].PixelLocation[0] % m_stride == 0 && vertices[i].PixelLocation[1] % m_stride == 0)
+            {
+                vertices[count++] = vertices[i];
+            }
+        }
+        return count;
+
+    case PointCloudDecimation::Foreground:
+        if (bodyIndexMap == nullptr)
+        {
+            return numPoints;
+        }
+        for (uint32_t i = 0; i < numPoints; i++)
+        {
+            uint32_t pixelIndex = uint32_t(vertices[i].PixelLocation[1]) * width + uint32_t(vertices[i].PixelLocation[0]);
+            if (bodyIndexMap[pixelIndex] != BodyIndexBackground)
+            {
+                vertices[count++] = vertices[i];
+            }
+        }
+        return count;
+
+    case PointCloudDecimation::VoxelGrid:
+        // Keep the first vertex of each voxel. Vertices are in pixel order, so this is the top left one.
+        ResetVoxels(numPoints);
+        for (uint32_t i = 0; i < numPoints; i++)
+        {
+            float x, y, z;
+            GetPositionInMeter(vertices[i], x, y, z);
+            if (InsertVoxel(x, y, z))
+            {
+                vertices[count++] = vertices[i];
+            }
+        }
+        return count;
+
+    case PointCloudDecimation::Full:
+    case PointCloudDecimation::SkeletonOnly:
+    default:
+        return numPoints;
+    }
+}
+
+void PointCloudDecimator::ResetVoxels(uint32_t numPoints)
+{
+    // Keep the table at most half full, so probe sequences stay short
+    size_t capacity = 1024;
+    while (capacity < size_t(numPoints) * 2)
+    {
+        capacity *= 2;
+    }
+
+    m_voxelStamp++;
+    if (m_voxelKeys.size() < capacity || m_voxelStamp == 0)
+    {
+        if (m_voxelKeys.size() < capacity)
+        {
+            m_voxelKeys.resize(capacity);
+        }
+        m_voxelStamps.assign(m_voxelKeys.size(), 0);
+        m_voxelStamp = 1;
+    }
+    m_voxelMask = m_voxelKeys.size() - 1;
+}
+
+bool PointCloudDecimator::InsertVoxel(float x, float y, float z)
+{
+    uint64_t voxelX = uint64_t(int64_t(std::floor(x * m_inverseVoxelSize))) & VoxelCoordinateMask;
+    uint64_t voxelY = uint64_t(int64_t(std::floor(y * m_inverseVoxelSize))) & VoxelCoordinateMask;
+    uint64_t voxelZ = uint64_t(int64_t(std::floor(z * m_inverseVoxelSize))) & VoxelCoordinateMask;
+    uint64_t key = (voxelX << 42) | (voxelY << 21) | voxelZ;
+
+    // Fibonacci hashing spreads neighboring voxels over the table
+    uint64_t slot = ((key * 0x9E3779B97F4A7C15ull) >> 32) & m_voxelMask;
+    while (m_voxelStamps[slot] == m_voxelStamp)
+    {
+        if (m_voxelKeys[slot] == key)
+        {
+            return false;
+        }
+        slot = (slot + 1) & m_voxelMask;
+    }
+
+    m_voxelStamps[slot] = m_voxelStamp;
+    m_voxelKeys[slot] = key;
+    return true;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "WindowController3dTypes.h"
+
+namespace Visualization
+{
+    // Thins out point cloud vertices after they are built. Vertices are compacted in place at the start of
+    // the buffer in their original order, and the voxel grid reuses its memory between frames.
+    class PointCloudDecimator
+    {
+    public:
+        // The stride is in pixels and the voxel size in meters. Full and SkeletonOnly keep every vertex.
+        void SetDecimation(PointCloudDecimation decimation, uint32_t stride, float voxelSize);
+
+        // Return the number of vertices kept. The body index map has width pixels per row and is only
+        // used by Foreground decimation, which keeps every vertex without one.
+        uint32_t Decimate(PointCloudVertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width);
+        uint32_t Decimate(PackedPointCloudVertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width);
+
+    private:
+        template<typename Vertex>
+        uint32_t DecimateVertices(Vertex* vertices, uint32_t numPoints, const uint8_t* bodyIndexMap, uint32_t width);
+
+        // Prepare an empty voxel grid with room for numPoints occupied voxels
+        void ResetVoxels(uint32_t numPoints);
+
+        // Mark the voxel containing the position (in meters) as occupied. Returns false if it already was.
+        bool InsertVoxel(float x, float y, float z);
+
+        PointCloudDecimation m_decimation = PointCloudDecimation::Full;
+        uint32_t m_stride = 1;
+        float m_inverseVoxelSize = 1.f;
+
+        // Open addressing hash set of voxel coordinates. A slot is only occupied if its stamp is the
+        // current one, so the set is emptied per frame by advancing the stamp instead of clearing it.
+        std::vector<uint64_t> m_voxelKeys;
+        std::vector<uint32_t> m_voxelStamps;
+        uint32_t m_voxelStamp = 0;
+        uint64_t m_voxelMask = 0;
+    };
+}
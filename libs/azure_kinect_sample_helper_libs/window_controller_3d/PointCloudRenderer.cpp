@@ -8,6 +8,7 @@
 #include <stdarg.h>
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <thread>
 
 #include "PointCloudShaders.h"
@@ -75,11 +76,28 @@ void PointCloudRenderer::Create(GLFWwindow* window)
     glGenVertexArrays(1, &m_vertexArrayObject);
     glBindVertexArray(m_vertexArrayObject);
     glGenBuffers(1, &m_vertexBufferObject);
+    // Depth unprojection reads no vertex attributes, but drawing still needs a vertex array object
+    glGenVertexArrays(1, &m_emptyVertexArrayObject);
+    glBindVertexArray(0);
     m_viewIndex = glGetUniformLocation(m_shaderProgram, "view");
     m_projectionIndex = glGetUniformLocation(m_shaderProgram, "projection");
     m_enableShadingIndex = glGetUniformLocation(m_shaderProgram, "enableShading");
     m_xyTableSamplerIndex = glGetUniformLocation(m_shaderProgram, "xyTable");
     m_depthSamplerIndex = glGetUniformLocation(m_shaderProgram, "depth");
+    m_unprojectDepthIndex = glGetUniformLocation(m_shaderProgram, "unprojectDepth");
+    m_useBodyIndexMapIndex = glGetUniformLocation(m_shaderProgram, "useBodyIndexMap");
+    m_depthWidthIndex = glGetUniformLocation(m_shaderProgram, "depthWidth");
+    m_vertexPositionScaleIndex = glGetUniformLocation(m_shaderProgram, "vertexPositionScale");
+    m_bodyIndexMapSamplerIndex = glGetUniformLocation(m_shaderProgram, "bodyIndexMap");
+    m_bodyIndexColorsSamplerIndex = glGetUniformLocation(m_shaderProgram, "bodyIndexColors");
+    m_pixelStrideIndex = glGetUniformLocation(m_shaderProgram, "pixelStride");
+    m_foregroundOnlyIndex = glGetUniformLocation(m_shaderProgram, "foregroundOnly");
+
+    // The body index map and its palette are always bound to texture units 0 and 1
+    glUseProgram(m_shaderProgram);
+    glUniform1i(m_bodyIndexMapSamplerIndex, 0);
+    glUniform1i(m_bodyIndexColorsSamplerIndex, 1);
+    glUseProgram(0);
 }
 
 void PointCloudRenderer::Delete()
@@ -90,7 +108,18 @@ void PointCloudRenderer::Delete()
     }
 
     m_initialized = false;
+    DeleteVertexBufferFences();
     glDeleteBuffers(1, &m_vertexBufferObject);
+    m_vertexBufferObject = 0;
+    m_vertexBufferSegmentSize = 0;
+    glDeleteVertexArrays(1, &m_emptyVertexArrayObject);
+
+    GLuint textures[] = { m_xyTableTextureObject, m_depthTextureObject, m_bodyIndexTextureObject, m_bodyIndexColorsTextureObject };
+    glDeleteTextures(sizeof(textures) / sizeof(*textures), textures);
+    m_xyTableTextureObject = 0;
+    m_depthTextureObject = 0;
+    m_bodyIndexTextureObject = 0;
+    m_bodyIndexColorsTextureObject = 0;
 
     glDeleteShader(m_vertexShader);
     glDeleteShader(m_fragmentShader);
@@ -102,30 +131,47 @@ void PointCloudRenderer::InitializeDepthXYTable(const float* xyTableInterleaved,
     m_width = width;
     m_height = height;
 
+    // Storage is allocated once per resolution, so a new table replaces the textures of the previous one
+    GLuint textures[] = { m_xyTableTextureObject, m_depthTextureObject, m_bodyIndexTextureObject, m_bodyIndexColorsTextureObject };
+    glDeleteTextures(sizeof(textures) / sizeof(*textures), textures);
+
     glGenTextures(1, &m_xyTableTextureObject);
     glBindTexture(GL_TEXTURE_2D, m_xyTableTextureObject);
     glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32F, m_width, m_height);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RG, GL_FLOAT, xyTableInterleaved);
 
+    // The texture storage is immutable, so it is allocated once here and only its content changes per frame
     glGenTextures(1, &m_depthTextureObject);
+    glBindTexture(GL_TEXTURE_2D, m_depthTextureObject);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16UI, m_width, m_height);
+
+    // Integer textures are only complete with nearest filtering
+    glGenTextures(1, &m_bodyIndexTextureObject);
+    glBindTexture(GL_TEXTURE_2D, m_bodyIndexTextureObject);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, m_width, m_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &m_bodyIndexColorsTextureObject);
+    glBindTexture(GL_TEXTURE_2D, m_bodyIndexColorsTextureObject);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, PointCloudBodyIndexColorCount, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void PointCloudRenderer::UpdatePointClouds(
+void PointCloudRenderer::BindVertexUpload(
     GLFWwindow* window,
-    const PointCloudVertex* point3ds,
-    uint32_t numPoints,
     const uint16_t* depthFrame,
-    uint32_t width, uint32_t height,
-    bool useTestPointClouds)
+    uint32_t width, uint32_t height)
 {
     if (window != m_window)
     {
         Create(window);
     }
 
-    if (m_width != width && m_height != height)
+    if (m_width != width || m_height != height)
     {
         Fail("Width and Height (%u, %u) does not match the DepthXYTable settings: (%u, %u) are expected!", width, height, m_width, m_height);
     }
@@ -133,38 +179,181 @@ void PointCloudRenderer::UpdatePointClouds(
     glBindImageTexture(0, m_xyTableTextureObject, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
 
     glBindTexture(GL_TEXTURE_2D, m_depthTextureObject);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16UI, m_width, m_height);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, depthFrame);
+    glBindTexture(GL_TEXTURE_2D, 0);
     glBindImageTexture(1, m_depthTextureObject, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R16UI);
 
     glBindVertexArray(m_vertexArrayObject);
     // Create buffers and bind the geometry
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferObject);
+}
+
+GLintptr PointCloudRenderer::StreamVertices(const void* vertices, uint32_t numPoints, size_t vertexSize)
+{
+    // Every segment can hold a vertex for each depth pixel, so the buffer is only allocated again
+    // when the resolution changes or a larger vertex format is used
+    GLsizeiptr segmentSize = GLsizeiptr(std::max<size_t>(size_t(m_width) * m_height, numPoints) * vertexSize);
+    if (segmentSize > m_vertexBufferSegmentSize)
+    {
+        DeleteVertexBufferFences();
+        glBufferData(GL_ARRAY_BUFFER, segmentSize * VertexBufferSegmentCount, nullptr, GL_STREAM_DRAW);
+        m_vertexBufferSegmentSize = segmentSize;
+    }
+
+    // Write to the segment after the one drawn last. It was drawn two updates ago at the earliest, so the
+    // fence has normally signaled already and the wait only happens if the GPU falls behind.
+    m_vertexBufferSegment = (m_vertexBufferSegment + 1) % VertexBufferSegmentCount;
+    GLsync& fence = m_vertexBufferFences[m_vertexBufferSegment];
+    if (fence != nullptr)
+    {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, VertexBufferFenceTimeoutNs);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLintptr offset = m_vertexBufferSegment * m_vertexBufferSegmentSize;
+    GLsizeiptr size = GLsizeiptr(numPoints * vertexSize);
+    if (size > 0)
+    {
+        // The fence already guarantees the GPU is done with the segment, so the driver does not need to synchronize
+        void* segment = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (segment == nullptr)
+        {
+            Fail("Mapping %lld bytes of the point cloud vertex buffer failed!", static_cast<long long>(size));
+        }
+        memcpy(segment, vertices, size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    return offset;
+}
+
+void PointCloudRenderer::DeleteVertexBufferFences()
+{
+    for (GLsync& fence : m_vertexBufferFences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+void PointCloudRenderer::UpdatePointClouds(
+    GLFWwindow* window,
+    const PointCloudVertex* point3ds,
+    uint32_t numPoints,
+    const uint16_t* depthFrame,
+    uint32_t width, uint32_t height,
+    bool useTestPointClouds)
+{
+    BindVertexUpload(window, depthFrame, width, height);
 
+    GLintptr offset;
     if (!useTestPointClouds)
     {
-        glBufferData(GL_ARRAY_BUFFER, numPoints * sizeof(PointCloudVertex), point3ds, GL_STREAM_DRAW);
+        offset = StreamVertices(point3ds, numPoints, sizeof(PointCloudVertex));
     }
     else
     {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(testVertices), testVertices, GL_STREAM_DRAW);
+        offset = StreamVertices(testVertices, 8, sizeof(PointCloudVertex));
     }
 
     // Set the vertex attribute pointers
     // Vertex Positions
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointCloudVertex), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointCloudVertex), (void*)offset);
     // Vertex Colors
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PointCloudVertex), (void*)offsetof(PointCloudVertex, Color));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PointCloudVertex), (void*)(offset + offsetof(PointCloudVertex, Color)));
     // Vertex Pixel Location
     // Notice: For GL_INT type, we need to use glVertexAttribIPointer instead of glVertexAttribPointer
     glEnableVertexAttribArray(2);
-    glVertexAttribIPointer(2, 2, GL_INT, sizeof(PointCloudVertex), (void*)offsetof(PointCloudVertex, PixelLocation));
+    glVertexAttribIPointer(2, 2, GL_INT, sizeof(PointCloudVertex), (void*)(offset + offsetof(PointCloudVertex, PixelLocation)));
 
     glBindVertexArray(0);
 
     m_drawArraySize = useTestPointClouds ? 8 : GLsizei(numPoints);
+    m_unprojectDepth = false;
+    m_vertexFormat = PointCloudVertexFormat::Float;
+}
+
+void PointCloudRenderer::UpdatePointClouds(
+    GLFWwindow* window,
+    const PackedPointCloudVertex* point3ds,
+    uint32_t numPoints,
+    const uint16_t* depthFrame,
+    uint32_t width, uint32_t height)
+{
+    BindVertexUpload(window, depthFrame, width, height);
+
+    GLintptr offset = StreamVertices(point3ds, numPoints, sizeof(PackedPointCloudVertex));
+
+    // Set the vertex attribute pointers
+    // Vertex Positions in millimeters, scaled to meters by the shader
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, sizeof(PackedPointCloudVertex), (void*)offset);
+    // Vertex Colors, normalized from 0-255 to 0-1
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedPointCloudVertex), (void*)(offset + offsetof(PackedPointCloudVertex, Color)));
+    // Vertex Pixel Location
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, sizeof(PackedPointCloudVertex), (void*)(offset + offsetof(PackedPointCloudVertex, PixelLocation)));
+
+    glBindVertexArray(0);
+
+    m_drawArraySize = GLsizei(numPoints);
+    m_unprojectDepth = false;
+    m_vertexFormat = PointCloudVertexFormat::Packed;
+}
+
+void PointCloudRenderer::UpdateDepthPointClouds(
+    GLFWwindow* window,
+    const uint16_t* depthFrame,
+    const uint8_t* bodyIndexMap,
+    const vec4* bodyIndexColors,
+    uint32_t width, uint32_t height)
+{
+    if (window != m_window)
+    {
+        Create(window);
+    }
+
+    if (m_xyTableTextureObject == 0)
+    {
+        Fail("Depth unprojection needs the DepthXYTable to be initialized!");
+    }
+
+    if (m_width != width || m_height != height)
+    {
+        Fail("Width and Height (%u, %u) does not match the DepthXYTable settings: (%u, %u) are expected!", width, height, m_width, m_height);
+    }
+
+    glBindImageTexture(0, m_xyTableTextureObject, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+
+    glBindTexture(GL_TEXTURE_2D, m_depthTextureObject);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, depthFrame);
+    glBindImageTexture(1, m_depthTextureObject, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R16UI);
+
+    // Rows of the body index map are not necessarily 4 byte aligned
+    m_useBodyIndexMap = bodyIndexMap != nullptr;
+    if (m_useBodyIndexMap)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, m_bodyIndexTextureObject);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, bodyIndexMap);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_bodyIndexColorsTextureObject);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PointCloudBodyIndexColorCount, 1, GL_RGBA, GL_FLOAT, bodyIndexColors);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The number of points depends on the stride, so it is set when rendering
+    m_drawArraySize = 0;
+    m_unprojectDepth = true;
 }
 
 void PointCloudRenderer::SetShading(bool enableShading)
@@ -172,6 +361,12 @@ void PointCloudRenderer::SetShading(bool enableShading)
     m_enableShading = enableShading;
 }
 
+void PointCloudRenderer::SetDecimation(uint32_t pixelStride, bool foregroundOnly)
+{
+    m_pixelStride = std::max(pixelStride, 1u);
+    m_foregroundOnly = foregroundOnly;
+}
+
 void PointCloudRenderer::Render()
 {
     std::array<int, 4> data; // x, y, width, height
@@ -198,7 +393,7 @@ void PointCloudRenderer::Render(int width, int height)
     }
     else
     {
-        pointSize = std::min(2.f * width / (float)m_width, 2.f * height / (float)m_height);
+        pointSize = std::min(2.f * width / (float)m_width, 2.f * height / (float)m_height) * m_pixelStride;
     }
     glPointSize(pointSize);
 
@@ -210,10 +405,46 @@ void PointCloudRenderer::Render(int width, int height)
 
     // Update render settings in shader
     glUniform1i(m_enableShadingIndex, (GLint)m_enableShading);
+    glUniform1i(m_unprojectDepthIndex, (GLint)m_unprojectDepth);
+    glUniform1f(m_vertexPositionScaleIndex, m_vertexFormat == PointCloudVertexFormat::Packed ? 0.001f : 1.f);
 
     // Render point cloud
-    glBindVertexArray(m_vertexArrayObject);
-    glDrawArrays(GL_POINTS, 0, m_drawArraySize);
+    if (m_unprojectDepth)
+    {
+        glUniform1i(m_useBodyIndexMapIndex, (GLint)m_useBodyIndexMap);
+        glUniform1i(m_depthWidthIndex, (GLint)m_width);
+        glUniform1i(m_pixelStrideIndex, (GLint)m_pixelStride);
+        glUniform1i(m_foregroundOnlyIndex, (GLint)m_foregroundOnly);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_bodyIndexTextureObject);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_bodyIndexColorsTextureObject);
+
+        // One point per depth pixel the stride keeps; invalid and background pixels are clipped by the vertex shader
+        GLsizei stridedWidth = GLsizei((m_width + m_pixelStride - 1) / m_pixelStride);
+        GLsizei stridedHeight = GLsizei((m_height + m_pixelStride - 1) / m_pixelStride);
+        glBindVertexArray(m_emptyVertexArrayObject);
+        glDrawArrays(GL_POINTS, 0, stridedWidth * stridedHeight);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    else
+    {
+        glBindVertexArray(m_vertexArrayObject);
+        glDrawArrays(GL_POINTS, 0, m_drawArraySize);
+
+        // Mark when the GPU is done with the segment, so the next upload to it can wait for that.
+        // With several viewports, the fence of the last draw replaces the previous ones.
+        GLsync& fence = m_vertexBufferFences[m_vertexBufferSegment];
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
     glBindVertexArray(0);
 }
 
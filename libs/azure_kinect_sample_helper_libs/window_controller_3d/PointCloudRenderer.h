@@ -15,6 +15,9 @@
 
 namespace Visualization
 {
+    // Number of body index map values, and so of body index palette colors
+    const uint32_t PointCloudBodyIndexColorCount = 256;
+
     class PointCloudRenderer : public RendererBase
     {
     public:
@@ -34,14 +37,48 @@ namespace Visualization
             uint32_t width, uint32_t height,
             bool useTestPointClouds = false);
 
+        // Same as above with vertices in the packed format, which is less than half the size to upload
+        void UpdatePointClouds(
+            GLFWwindow* window,
+            const Visualization::PackedPointCloudVertex* point3ds,
+            uint32_t numPoints,
+            const uint16_t* depthFrame,
+            uint32_t width, uint32_t height);
+
+        // Render the depth frame without vertices: the vertex shader unprojects every pixel with the DepthXYTable
+        // and colors it with the palette entry of its body index map value. The palette has PointCloudBodyIndexColorCount colors.
+        // Without a body index map, every point gets the color of the background entry.
+        void UpdateDepthPointClouds(
+            GLFWwindow* window,
+            const uint16_t* depthFrame,
+            const uint8_t* bodyIndexMap,
+            const linmath::vec4* bodyIndexColors,
+            uint32_t width, uint32_t height);
+
         void SetShading(bool enableShading);
 
+        // Draw only every pixelStride-th pixel of every pixelStride-th row, with points scaled up to fill the gaps,
+        // and with foregroundOnly only pixels of a body. Both only apply to unprojected depth frames, since built
+        // vertices are decimated before they are uploaded, but the point size always follows the stride.
+        void SetDecimation(uint32_t pixelStride, bool foregroundOnly);
+
         void Render() override;
         void Render(int width, int height);
 
         void ChangePointCloudSize(float pointCloudSize);
 
     private:
+        // Check the frame size, upload the depth frame and bind the vertex buffer for the vertices to be uploaded
+        void BindVertexUpload(
+            GLFWwindow* window,
+            const uint16_t* depthFrame,
+            uint32_t width, uint32_t height);
+
+        // Copy vertices into the next segment of the vertex buffer ring and return the segment's byte offset
+        GLintptr StreamVertices(const void* vertices, uint32_t numPoints, size_t vertexSize);
+
+        void DeleteVertexBufferFences();
+
         // Render settings
         const GLfloat m_defaultPointCloudSize = 0.5f;
         std::optional<GLfloat> m_pointCloudSize;
@@ -50,6 +87,13 @@ namespace Visualization
         // Point Array Size
         GLsizei m_drawArraySize = 0;
 
+        // Positions are unprojected from the depth texture instead of read from the vertex buffer
+        bool m_unprojectDepth = false;
+        bool m_useBodyIndexMap = false;
+        uint32_t m_pixelStride = 1;
+        bool m_foregroundOnly = false;
+        PointCloudVertexFormat m_vertexFormat = PointCloudVertexFormat::Float;
+
         // Depth Frame Information
         uint32_t m_width = 0;
         uint32_t m_height = 0;
@@ -58,14 +102,33 @@ namespace Visualization
         GLuint m_vertexArrayObject = 0;
         GLuint m_vertexBufferObject = 0;
 
+        // The vertex buffer is a ring of segments, each sized for a full depth frame. Uploads write to the next
+        // segment while the GPU may still draw from the previous ones, and fences keep them from overtaking it.
+        static const int VertexBufferSegmentCount = 3;
+        static const GLuint64 VertexBufferFenceTimeoutNs = 1000000000;
+        GLsizeiptr m_vertexBufferSegmentSize = 0;
+        int m_vertexBufferSegment = 0;
+        GLsync m_vertexBufferFences[VertexBufferSegmentCount] = {};
+        GLuint m_emptyVertexArrayObject = 0;
+
         GLuint m_xyTableTextureObject = 0;
         GLuint m_depthTextureObject = 0;
+        GLuint m_bodyIndexTextureObject = 0;
+        GLuint m_bodyIndexColorsTextureObject = 0;
 
         GLuint m_viewIndex = 0;
         GLuint m_projectionIndex = 0;
         GLuint m_enableShadingIndex = 0;
         GLuint m_xyTableSamplerIndex = 0;
         GLuint m_depthSamplerIndex = 0;
+        GLuint m_unprojectDepthIndex = 0;
+        GLuint m_useBodyIndexMapIndex = 0;
+        GLuint m_depthWidthIndex = 0;
+        GLuint m_vertexPositionScaleIndex = 0;
+        GLuint m_bodyIndexMapSamplerIndex = 0;
+        GLuint m_bodyIndexColorsSamplerIndex = 0;
+        GLuint m_pixelStrideIndex = 0;
+        GLuint m_foregroundOnlyIndex = 0;
 
         // Lock
         std::mutex m_mutex;
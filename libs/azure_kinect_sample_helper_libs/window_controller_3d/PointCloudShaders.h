@@ -18,15 +18,40 @@ static const char* const glslPointCloudVertexShader = GLSL_STRING(
     uniform mat4 projection;
     uniform bool enableShading;
 
+    // Vertex positions are in meters, or in millimeters for packed vertices
+    uniform float vertexPositionScale;
+
+    // When unprojectDepth is set, there are no vertex attributes. Each vertex is the depth pixel
+    // gl_VertexID, its position comes from the depth and xyTable images and its color is the
+    // bodyIndexColors entry of its bodyIndexMap value.
+    uniform bool unprojectDepth;
+    uniform bool useBodyIndexMap;
+    uniform int depthWidth;
+    uniform usampler2D bodyIndexMap;
+    uniform sampler2D bodyIndexColors;
+
+    // Only every pixelStride-th pixel of every pixelStride-th row is drawn, and with foregroundOnly
+    // only pixels of a body
+    uniform int pixelStride;
+    uniform bool foregroundOnly;
+
     layout(rg32f, binding = 0) restrict readonly uniform image2D xyTable;
     layout(r16ui, binding = 1) restrict readonly uniform uimage2D depth;
 
-    vec3 ComputePoint3d(ivec2 pixelId)
+    // Body index map value of pixels that are not part of a body
+    const uint bodyIndexBackground = 255u;
+
+    // Position of a depth pixel in the Kinect camera coordinate, in meters, like the point cloud vertices
+    vec3 UnprojectPixel(ivec2 pixelId)
     {
         float depthInMeter = float(imageLoad(depth, pixelId).x) /  1000.f;
+        return vec3(imageLoad(xyTable, pixelId).xy, 1) * depthInMeter;
+    }
 
+    vec3 ComputePoint3d(ivec2 pixelId)
+    {
         // Calculate depth 3d point
-        vec3 point3d = vec3(imageLoad(xyTable, pixelId).xy, 1) * depthInMeter;
+        vec3 point3d = UnprojectPixel(pixelId);
 
         // If both x is 0 and y is 0, it means:
         // Either the xyTable at pixelId is invalid, or depthInMeter == 0.
@@ -40,17 +65,17 @@ static const char* const glslPointCloudVertexShader = GLSL_STRING(
         return vec3(point3d.x, -point3d.y, -point3d.z);
     }
 
-    vec3 ComputeNormal(ivec2 pixelId)
+    vec3 ComputeNormal(ivec2 pixelId, vec3 position)
     {
         vec3 pointLeft = ComputePoint3d(ivec2(pixelId.x - 1, pixelId.y));
         vec3 pointRight = ComputePoint3d(ivec2(pixelId.x + 1, pixelId.y));
         vec3 pointUp = ComputePoint3d(ivec2(pixelId.x, pixelId.y - 1));
         vec3 pointDown = ComputePoint3d(ivec2(pixelId.x, pixelId.y + 1));
 
-        pointLeft = pointLeft.z == 0 ? vertexPosition : pointLeft;
-        pointRight = pointRight.z == 0 ? vertexPosition : pointRight;
-        pointUp = pointUp.z == 0 ? vertexPosition : pointUp;
-        pointDown = pointDown.z == 0 ? vertexPosition : pointDown;
+        pointLeft = pointLeft.z == 0 ? position : pointLeft;
+        pointRight = pointRight.z == 0 ? position : pointRight;
+        pointUp = pointUp.z == 0 ? position : pointUp;
+        pointDown = pointDown.z == 0 ? position : pointDown;
 
         vec3 xDirection = pointRight - pointLeft;
         vec3 yDirection = pointUp - pointDown;
@@ -62,31 +87,55 @@ static const char* const glslPointCloudVertexShader = GLSL_STRING(
 
     void main()
     {
-        gl_Position = projection * view * vec4(vertexPosition, 1);
+        vec3 position = vertexPosition * vertexPositionScale;
+        vec4 color = vertexColor;
+        ivec2 pixel = pixelLocation;
+
+        if (unprojectDepth)
+        {
+            int stridedWidth = (depthWidth + pixelStride - 1) / pixelStride;
+            pixel = ivec2(gl_VertexID % stridedWidth, gl_VertexID / stridedWidth) * pixelStride;
+            position = UnprojectPixel(pixel);
+            uint bodyIndex = useBodyIndexMap ? texelFetch(bodyIndexMap, pixel, 0).x : bodyIndexBackground;
+
+            // Invalid depth or xyTable entry, or a background pixel that is not drawn: move the point
+            // behind the far plane so it is clipped
+            if (position.z == 0 || (position.x == 0 && position.y == 0) ||
+                (foregroundOnly && useBodyIndexMap && bodyIndex == bodyIndexBackground))
+            {
+                gl_Position = vec4(0, 0, 2, 1);
+                fragmentColor = vec4(0);
+                return;
+            }
+
+            color = texelFetch(bodyIndexColors, ivec2(bodyIndex, 0), 0);
+        }
+
+        gl_Position = projection * view * vec4(position, 1);
 
         if (enableShading)
         {
             const vec3 lightPosition = vec3(0, 0, 0);
-            vec3 vertexNormal = ComputeNormal(pixelLocation);
+            vec3 vertexNormal = ComputeNormal(pixel, position);
             float diffuse = 0.f;
             if (dot(vertexNormal, vertexNormal) != 0.f)
             {
-                vec3 lightDirection = normalize(lightPosition - vertexPosition);
+                vec3 lightDirection = normalize(lightPosition - position);
                 // Use mix function to reduce the strength of the diffuse effect
                 float defuseRatio = 0.7f;
                 diffuse = mix(1.0f, abs(dot(normalize(vertexNormal), lightDirection)), defuseRatio);
             }
 
-            float distance = length(lightPosition - vertexPosition);
+            float distance = length(lightPosition - position);
             // Attenuation term for light source that covers distance up to 50 meters
             // http://wiki.ogre3d.org/tiki-index.php?page=-Point+Light+Attenuation
             float attenuation = 1.0 / (1.0 + 0.09 * distance + 0.032 * distance * distance);
 
-            fragmentColor = vec4(attenuation * diffuse * vertexColor.rgb, vertexColor.a);
+            fragmentColor = vec4(attenuation * diffuse * color.rgb, color.a);
         }
         else
         {
-            fragmentColor = vertexColor;
+            fragmentColor = color;
         }
     }
 
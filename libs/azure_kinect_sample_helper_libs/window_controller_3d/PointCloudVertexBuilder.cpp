@@ -0,0 +1,378 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "PointCloudVertexBuilder.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define POINT_CLOUD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only compile AVX2 intrinsics in functions marked for AVX2; MSVC always does
+#if defined(POINT_CLOUD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define POINT_CLOUD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define POINT_CLOUD_TARGET_AVX2
+#endif
+
+using namespace Visualization;
+
+namespace
+{
+    const float MillimeterToMeter = 0.001f;
+
+    // Write one vertex. It is always written at the end of the packed vertices and only kept
+    // by the caller if the point is valid, so the loops do not branch on invalid points.
+    inline void WriteVertex(PointCloudVertex* vertex, const int16_t* point, const float* color, int w, int h)
+    {
+        vertex->Position[0] = static_cast<float>(point[0]) * MillimeterToMeter;
+        vertex->Position[1] = static_cast<float>(point[1]) * MillimeterToMeter;
+        vertex->Position[2] = static_cast<float>(point[2]) * MillimeterToMeter;
+        memcpy(vertex->Color, color, sizeof(vertex->Color));
+        vertex->PixelLocation[0] = w;
+        vertex->PixelLocation[1] = h;
+    }
+
+    // Build the vertices of one row from the passed column to the end of the row
+    inline uint32_t BuildRowScalar(
+        const int16_t* pointRow,
+        const uint8_t* bodyIndexRow,
+        const linmath::vec4* bodyIndexColors,
+        const float* defaultColor,
+        uint32_t firstColumn,
+        uint32_t width,
+        int h,
+        PointCloudVertex* vertices,
+        uint32_t count)
+    {
+        for (uint32_t w = firstColumn; w < width; w++)
+        {
+            const int16_t* point = pointRow + 3 * w;
+            const float* color = bodyIndexRow != nullptr ? bodyIndexColors[bodyIndexRow[w]] : defaultColor;
+            WriteVertex(vertices + count, point, color, static_cast<int>(w), h);
+            count += point[2] != 0 ? 1 : 0;
+        }
+        return count;
+    }
+
+    uint32_t BuildScalar(
+        const int16_t* pointCloud,
+        const uint8_t* bodyIndexMap,
+        const linmath::vec4* bodyIndexColors,
+        const float* defaultColor,
+        uint32_t width,
+        uint32_t height,
+        PointCloudVertex* vertices)
+    {
+        uint32_t count = 0;
+        for (uint32_t h = 0; h < height; h++)
+        {
+            const int16_t* pointRow = pointCloud + 3 * h * width;
+            const uint8_t* bodyIndexRow = bodyIndexMap != nullptr ? bodyIndexMap + h * width : nullptr;
+            count = BuildRowScalar(pointRow, bodyIndexRow, bodyIndexColors, defaultColor, 0, width, static_cast<int>(h), vertices, count);
+        }
+        return count;
+    }
+
+#ifdef POINT_CLOUD_X86
+    // Mask of the pixels of a group with a z other than 0, from a mask of the coordinates that are 0
+    inline uint32_t ValidPixelMask(uint32_t zeroCoordinates, int groupSize)
+    {
+        uint32_t valid = 0;
+        for (int k = 0; k < groupSize; k++)
+        {
+            valid |= ((~zeroCoordinates >> (3 * k + 2)) & 1u) << k;
+        }
+        return valid;
+    }
+
+    // Store the converted positions of a group of pixels, their colors and pixel locations, keeping the
+    // pixels in the valid mask. The callers skip groups without valid pixels before converting them.
+    // Vertices are 36 bytes, so a shuffle table cannot compress them like packed lanes; every pixel of a group
+    // with depth is written at the end and only kept if valid, which does not branch on scattered holes.
+    // The 16-byte position store also covers the first color channel, which the color store then overwrites.
+    inline uint32_t StoreGroup(
+        const float* positions,
+        uint32_t validPixels,
+        const uint8_t* bodyIndexGroup,
+        const linmath::vec4* bodyIndexColors,
+        const float* defaultColor,
+        int groupSize,
+        int w,
+        int h,
+        PointCloudVertex* vertices,
+        uint32_t count)
+    {
+        for (int k = 0; k < groupSize; k++)
+        {
+            PointCloudVertex* vertex = vertices + count;
+            const float* color = bodyIndexGroup != nullptr ? bodyIndexColors[bodyIndexGroup[k]] : defaultColor;
+            _mm_storeu_ps(vertex->Position, _mm_loadu_ps(positions + 3 * k));
+            _mm_storeu_ps(vertex->Color, _mm_loadu_ps(color));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(vertex->PixelLocation), _mm_setr_epi32(w + k, h, 0, 0));
+            count += (validPixels >> k) & 1u;
+        }
+        return count;
+    }
+
+    uint32_t BuildSse2(
+        const int16_t* pointCloud,
+        const uint8_t* bodyIndexMap,
+        const linmath::vec4* bodyIndexColors,
+        const float* defaultColor,
+        uint32_t width,
+        uint32_t height,
+        PointCloudVertex* vertices)
+    {
+        const __m128 scale = _mm_set1_ps(MillimeterToMeter);
+
+        // Positions of 4 pixels, with padding so the last position can be loaded as 4 floats
+        alignas(16) float positions[16] = {};
+
+        uint32_t count = 0;
+        for (uint32_t h = 0; h < height; h++)
+        {
+            const int16_t* pointRow = pointCloud + 3 * h * width;
+            const uint8_t* bodyIndexRow = bodyIndexMap != nullptr ? bodyIndexMap + h * width : nullptr;
+
+            uint32_t w = 0;
+            for (; w + 4 <= width; w += 4)
+            {
+                // Load x, y, z of 4 pixels and sign extend them to 32 bits
+                const int16_t* pointGroup = pointRow + 3 * w;
+                __m128i xyz0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pointGroup));
+                __m128i xyz1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pointGroup + 8));
+
+                // Find the pixels with depth from the coordinates that are 0, one bit per coordinate
+                __m128i zero = _mm_setzero_si128();
+                __m128i zeroCoordinates = _mm_packs_epi16(_mm_cmpeq_epi16(xyz0, zero), _mm_cmpeq_epi16(xyz1, zero));
+                uint32_t validPixels = ValidPixelMask(static_cast<uint32_t>(_mm_movemask_epi8(zeroCoordinates)), 4);
+                if (validPixels == 0)
+                {
+                    continue;
+                }
+
+                __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(xyz0, xyz0), 16));
+                __m128 mid = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(xyz0, xyz0), 16));
+                __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(xyz1, xyz1), 16));
+
+                _mm_store_ps(positions + 0, _mm_mul_ps(lo, scale));
+                _mm_store_ps(positions + 4, _mm_mul_ps(mid, scale));
+                _mm_store_ps(positions + 8, _mm_mul_ps(hi, scale));
+
+                count = StoreGroup(positions, validPixels, bodyIndexRow != nullptr ? bodyIndexRow + w : nullptr,
+                    bodyIndexColors, defaultColor, 4, static_cast<int>(w), static_cast<int>(h), vertices, count);
+            }
+
+            count = BuildRowScalar(pointRow, bodyIndexRow, bodyIndexColors, defaultColor, w, width, static_cast<int>(h), vertices, count);
+        }
+        return count;
+    }
+
+    POINT_CLOUD_TARGET_AVX2
+    uint32_t BuildAvx2(
+        const int16_t* pointCloud,
+        const uint8_t* bodyIndexMap,
+        const linmath::vec4* bodyIndexColors,
+        const float* defaultColor,
+        uint32_t width,
+        uint32_t height,
+        PointCloudVertex* vertices)
+    {
+        const __m256 scale = _mm256_set1_ps(MillimeterToMeter);
+
+        // Positions of 8 pixels, with padding so the last position can be loaded as 4 floats
+        alignas(32) float positions[32] = {};
+
+        uint32_t count = 0;
+        for (uint32_t h = 0; h < height; h++)
+        {
+            const int16_t* pointRow = pointCloud + 3 * h * width;
+            const uint8_t* bodyIndexRow = bodyIndexMap != nullptr ? bodyIndexMap + h * width : nullptr;
+
+            uint32_t w = 0;
+            for (; w + 8 <= width; w += 8)
+            {
+                // Load x, y, z of 8 pixels and sign extend them to 32 bits
+                const int16_t* pointGroup = pointRow + 3 * w;
+                __m128i packed0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pointGroup));
+                __m128i packed1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pointGroup + 8));
+                __m128i packed2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pointGroup + 16));
+
+                // Find the pixels with depth from the coordinates that are 0, one bit per coordinate
+                __m128i zero = _mm_setzero_si128();
+                uint32_t zeroCoordinates = static_cast<uint32_t>(_mm_movemask_epi8(
+                    _mm_packs_epi16(_mm_cmpeq_epi16(packed0, zero), _mm_cmpeq_epi16(packed1, zero))));
+                zeroCoordinates |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(packed2, zero), zero))) << 16;
+                uint32_t validPixels = ValidPixelMask(zeroCoordinates, 8);
+                if (validPixels == 0)
+                {
+                    continue;
+                }
+
+                __m256i xyz0 = _mm256_cvtepi16_epi32(packed0);
+                __m256i xyz1 = _mm256_cvtepi16_epi32(packed1);
+                __m256i xyz2 = _mm256_cvtepi16_epi32(packed2);
+
+                _mm256_store_ps(positions + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(xyz0), scale));
+                _mm256_store_ps(positions + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(xyz1), scale));
+                _mm256_store_ps(positions + 16, _mm256_mul_ps(_mm256_cvtepi32_ps(xyz2), scale));
+
+                count = StoreGroup(positions, validPixels, bodyIndexRow != nullptr ? bodyIndexRow + w : nullptr,
+                    bodyIndexColors, defaultColor, 8, static_cast<int>(w), static_cast<int>(h), vertices, count);
+            }
+
+            count = BuildRowScalar(pointRow, bodyIndexRow, bodyIndexColors, defaultColor, w, width, static_cast<int>(h), vertices, count);
+        }
+        return count;
+    }
+
+    bool CpuSupportsAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // The operating system also has to save the AVX registers on context switches
+        __cpuid(info, 1);
+        bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+        __cpuidex(info, 7, 0);
+        return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+}
+
+bool Visualization::IsPointCloudKernelSupported(PointCloudKernel kernel)
+{
+    switch (kernel)
+    {
+    case PointCloudKernel::Scalar:
+        return true;
+#ifdef POINT_CLOUD_X86
+    case PointCloudKernel::Sse2:
+        return true;
+    case PointCloudKernel::Avx2:
+    {
+        static const bool avx2 = CpuSupportsAvx2();
+        return avx2;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+PointCloudKernel Visualization::GetFastestPointCloudKernel()
+{
+    if (IsPointCloudKernelSupported(PointCloudKernel::Avx2))
+    {
+        return PointCloudKernel::Avx2;
+    }
+    if (IsPointCloudKernelSupported(PointCloudKernel::Sse2))
+    {
+        return PointCloudKernel::Sse2;
+    }
+    return PointCloudKernel::Scalar;
+}
+
+const char* Visualization::GetPointCloudKernelName(PointCloudKernel kernel)
+{
+    switch (kernel)
+    {
+    case PointCloudKernel::Sse2:
+        return "SSE2";
+    case PointCloudKernel::Avx2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+uint32_t Visualization::BuildPointCloudVertices(
+    PointCloudKernel kernel,
+    const int16_t* pointCloud,
+    const uint8_t* bodyIndexMap,
+    const linmath::vec4* bodyIndexColors,
+    const linmath::vec4 defaultColor,
+    uint32_t width,
+    uint32_t height,
+    PointCloudVertex* vertices)
+{
+    if (!IsPointCloudKernelSupported(kernel))
+    {
+        kernel = PointCloudKernel::Scalar;
+    }
+
+    switch (kernel)
+    {
+#ifdef POINT_CLOUD_X86
+    case PointCloudKernel::Sse2:
+        return BuildSse2(pointCloud, bodyIndexMap, bodyIndexColors, defaultColor, width, height, vertices);
+    case PointCloudKernel::Avx2:
+        return BuildAvx2(pointCloud, bodyIndexMap, bodyIndexColors, defaultColor, width, height, vertices);
+#endif
+    default:
+        return BuildScalar(pointCloud, bodyIndexMap, bodyIndexColors, defaultColor, width, height, vertices);
+    }
+}
+
+uint32_t Visualization::PackPointCloudColor(const linmath::vec4 color)
+{
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++)
+    {
+        float channel = color[i] < 0.f ? 0.f : (color[i] > 1.f ? 1.f : color[i]);
+        bytes[i] = static_cast<uint8_t>(channel * 255.f + 0.5f);
+    }
+
+    uint32_t packedColor;
+    memcpy(&packedColor, bytes, sizeof(packedColor));
+    return packedColor;
+}
+
+uint32_t Visualization::BuildPackedPointCloudVertices(
+    const int16_t* pointCloud,
+    const uint8_t* bodyIndexMap,
+    const uint32_t* bodyIndexColors,
+    uint32_t defaultColor,
+    uint32_t width,
+    uint32_t height,
+    PackedPointCloudVertex* vertices)
+{
+    // The positions are copied without conversion, so unlike the float builders this is bound by memory
+    // bandwidth and the same compaction as BuildRowScalar is all it needs
+    uint32_t count = 0;
+    for (uint32_t h = 0; h < height; h++)
+    {
+        const int16_t* pointRow = pointCloud + 3 * h * width;
+        const uint8_t* bodyIndexRow = bodyIndexMap != nullptr ? bodyIndexMap + h * width : nullptr;
+        for (uint32_t w = 0; w < width; w++)
+        {
+            const int16_t* point = pointRow + 3 * w;
+            PackedPointCloudVertex* vertex = vertices + count;
+            vertex->Position[0] = point[0];
+            vertex->Position[1] = point[1];
+            vertex->Position[2] = point[2];
+            vertex->Position[3] = 0;
+            uint32_t color = bodyIndexRow != nullptr ? bodyIndexColors[bodyIndexRow[w]] : defaultColor;
+            memcpy(vertex->Color, &color, sizeof(vertex->Color));
+            vertex->PixelLocation[0] = static_cast<uint16_t>(w);
+            vertex->PixelLocation[1] = static_cast<uint16_t>(h);
+            count += point[2] != 0 ? 1 : 0;
+        }
+    }
+    return count;
+}
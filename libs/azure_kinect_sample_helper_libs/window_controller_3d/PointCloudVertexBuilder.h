@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+
+#include "linmath.h"
+#include "WindowController3dTypes.h"
+
+namespace Visualization
+{
+    // Implementations of the point cloud vertex builder. Every implementation produces the same vertices.
+    enum class PointCloudKernel
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    // Check if the processor and operating system can run the passed kernel
+    bool IsPointCloudKernelSupported(PointCloudKernel kernel);
+
+    // Fastest kernel the processor supports
+    PointCloudKernel GetFastestPointCloudKernel();
+
+    const char* GetPointCloudKernelName(PointCloudKernel kernel);
+
+    // Convert a point cloud image (int16 x, y, z in millimeters per pixel) to vertices in meters in one pass.
+    // Points with a z of 0 are invalid and skipped, and valid points are packed at the start of the vertex
+    // buffer, which needs room for width * height vertices. Each point gets the palette color of its body
+    // index map value, or the default color if there is no body index map. Returns the number of valid points.
+    uint32_t BuildPointCloudVertices(
+        PointCloudKernel kernel,
+        const int16_t* pointCloud,
+        const uint8_t* bodyIndexMap,
+        const linmath::vec4* bodyIndexColors,
+        const linmath::vec4 defaultColor,
+        uint32_t width,
+        uint32_t height,
+        PointCloudVertex* vertices);
+
+    // Convert a color with channels from 0 to 1 to the RGBA bytes of a packed vertex, saturating each channel
+    uint32_t PackPointCloudColor(const linmath::vec4 color);
+
+    // Same as BuildPointCloudVertices for packed vertices: positions stay in millimeters and the palette
+    // and default color are packed with PackPointCloudColor. Returns the number of valid points.
+    uint32_t BuildPackedPointCloudVertices(
+        const int16_t* pointCloud,
+        const uint8_t* bodyIndexMap,
+        const uint32_t* bodyIndexColors,
+        uint32_t defaultColor,
+        uint32_t width,
+        uint32_t height,
+        PackedPointCloudVertex* vertices);
+}
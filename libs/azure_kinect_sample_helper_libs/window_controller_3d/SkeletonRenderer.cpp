@@ -60,16 +60,19 @@ void SkeletonRenderer::CleanJointsAndBones()
 {
     m_joints.clear();
     m_bones.clear();
+    m_instancesUpdated = false;
 }
 
 void SkeletonRenderer::AddJoint(const Visualization::Joint& joint)
 {
     m_joints.push_back(joint);
+    m_instancesUpdated = false;
 }
 
 void SkeletonRenderer::AddBone(const Visualization::Bone& bone)
 {
     m_bones.push_back(bone);
+    m_instancesUpdated = false;
 }
 
 void SkeletonRenderer::UpdateViewProjection(linmath::mat4x4 view, linmath::mat4x4 projection)
@@ -87,33 +90,62 @@ void SkeletonRenderer::Render()
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    if (!m_instancesUpdated)
+    {
+        UpdateInstances();
+    }
+
+    // Each primitive type is drawn with one instanced call for all bodies
     if (m_renderSkeletons)
     {
         // Render Bones
-        for (size_t i = 0; i < m_bones.size(); i++)
-        {
-            m_cylinder.Render(
-                m_bones[i].Joint1Position,
-                m_bones[i].Joint2Position,
-                m_bones[i].Color);
-        }
+        m_cylinder.RenderInstances();
 
         // Render Joints
-        for (size_t i = 0; i < m_joints.size(); i++)
-        {
-            RenderJoint(m_joints[i].Position, m_joints[i].Color);
-        }
+        m_sphere.RenderInstances();
     }
 
     if (m_renderCoordinateAxes)
     {
         // Render Joint Coordinate
-        for (size_t i = 0; i < m_joints.size(); i++)
+        m_coordinateAxes.RenderInstances();
+    }
+    glBindVertexArray(0);
+}
+
+void SkeletonRenderer::UpdateInstances()
+{
+    // Bones whose joints coincide have nothing to draw and would give the cylinder a singular model matrix
+    m_boneInstances.resize(m_bones.size());
+    size_t boneInstanceCount = 0;
+    for (size_t i = 0; i < m_bones.size(); i++)
+    {
+        if (m_cylinder.ComputeModel(m_boneInstances[boneInstanceCount].Model, m_bones[i].Joint1Position, m_bones[i].Joint2Position))
         {
-            RenderCoordinateAxes(m_joints[i].Position, m_joints[i].Orientation);
+            vec4_copy(m_boneInstances[boneInstanceCount].Color, m_bones[i].Color);
+            boneInstanceCount++;
         }
     }
-    glBindVertexArray(0);
+    m_boneInstances.resize(boneInstanceCount);
+
+    m_jointInstances.resize(m_joints.size());
+    m_jointFrameInstances.resize(m_joints.size());
+    for (size_t i = 0; i < m_joints.size(); i++)
+    {
+        const Joint& joint = m_joints[i];
+        mat4x4_translate(m_jointInstances[i].Model, joint.Position[0], joint.Position[1], joint.Position[2]);
+        vec4_copy(m_jointInstances[i].Color, joint.Color);
+
+        mat4x4 rotation;
+        quaternion_to_mat4x4(rotation, joint.Orientation);
+        mat4x4_mul(m_jointFrameInstances[i].Model, m_jointInstances[i].Model, rotation);
+        vec4_copy(m_jointFrameInstances[i].Color, joint.Color);
+    }
+
+    m_cylinder.UpdateInstances(m_boneInstances.data(), m_boneInstances.size());
+    m_sphere.UpdateInstances(m_jointInstances.data(), m_jointInstances.size());
+    m_coordinateAxes.UpdateInstances(m_jointFrameInstances.data(), m_jointFrameInstances.size());
+    m_instancesUpdated = true;
 }
 
 void SkeletonRenderer::RenderJoint(const linmath::vec3 p, const linmath::vec4 color)
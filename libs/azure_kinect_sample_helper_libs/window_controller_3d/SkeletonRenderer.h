@@ -44,6 +44,9 @@ namespace Visualization
         const std::vector<Joint>& GetJoints() { return m_joints; }
 
     private:
+        // Compute the model matrix of every bone, joint and joint frame and upload them for instanced rendering
+        void UpdateInstances();
+
         // Render settings
         bool m_renderSkeletons = true;
         bool m_renderCoordinateAxes = false;
@@ -62,5 +65,12 @@ namespace Visualization
         // Skeleton information
         std::vector<Joint> m_joints;
         std::vector<Bone> m_bones;
+
+        // Instances of the current joints and bones. They are only computed and uploaded again after the joints
+        // or bones change, so the views of the multi-view layouts draw the same instances.
+        bool m_instancesUpdated = false;
+        std::vector<ObjectInstance> m_boneInstances;
+        std::vector<ObjectInstance> m_jointInstances;
+        std::vector<ObjectInstance> m_jointFrameInstances;
     };
 }
\ No newline at end of file
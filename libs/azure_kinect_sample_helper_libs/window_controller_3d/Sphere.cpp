@@ -94,6 +94,10 @@ void Sphere::Create(GLFWwindow * window)
     m_modelIndex = glGetUniformLocation(m_shaderProgram, "model");
     m_viewIndex = glGetUniformLocation(m_shaderProgram, "view");
     m_projectionIndex = glGetUniformLocation(m_shaderProgram, "projection");
+
+    m_instancedShaderProgram = CreateShaderProgram(glslMonoObjectInstancedVertexShader, glslMonoObjectFragmentShader);
+    m_instancedViewIndex = glGetUniformLocation(m_instancedShaderProgram, "view");
+    m_instancedProjectionIndex = glGetUniformLocation(m_instancedShaderProgram, "projection");
     m_colorIndex = glGetUniformLocation(m_shaderProgram, "color");
 
     // **************** Generate Sphere VAO ****************
@@ -119,6 +123,10 @@ void Sphere::Create(GLFWwindow * window)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBufferObject);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STATIC_DRAW);
 
+    // Per-instance attributes for instanced rendering
+    glGenBuffers(1, &m_instanceBufferObject);
+    SetInstanceAttributes(m_instanceBufferObject);
+
     // **************** Unbind VAO ****************
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -135,6 +143,9 @@ void Sphere::Delete()
     m_initialized = false;
     glDeleteBuffers(1, &m_vertexBufferObject);
     glDeleteBuffers(1, &m_elementBufferObject);
+    glDeleteBuffers(1, &m_instanceBufferObject);
+    glDeleteProgram(m_instancedShaderProgram);
+    m_instanceCount = 0;
 
     glDeleteShader(m_vertexShader);
     glDeleteShader(m_fragmentShader);
@@ -172,6 +183,29 @@ void Sphere::Render(const linmath::vec3 p, const linmath::vec4 color)
     Render(model, color);
 }
 
+void Sphere::UpdateInstances(const ObjectInstance* instances, size_t count)
+{
+    UpdateInstanceBuffer(m_instanceBufferObject, instances, count);
+    m_instanceCount = static_cast<GLsizei>(count);
+}
+
+void Sphere::RenderInstances()
+{
+    if (m_instanceCount == 0)
+    {
+        return;
+    }
+
+    glUseProgram(m_instancedShaderProgram);
+
+    // Update view/projective matrices in shader; the model matrices are instance attributes
+    glUniformMatrix4fv(m_instancedViewIndex, 1, GL_FALSE, (const GLfloat*)m_view);
+    glUniformMatrix4fv(m_instancedProjectionIndex, 1, GL_FALSE, (const GLfloat*)m_projection);
+
+    glBindVertexArray(m_vertexArrayObject);
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_indices.size(), GL_UNSIGNED_INT, NULL, m_instanceCount);
+}
+
 // build vertices of sphere with smooth shading using parametric equation
 // x = r * cos(u) * cos(v)
 // y = r * cos(u) * sin(v)
@@ -34,6 +34,10 @@ namespace Visualization
         void Render(const linmath::mat4x4 model, const linmath::vec4 color);
         void Render(const linmath::vec3 p, const linmath::vec4 color);
 
+        // Instanced rendering: upload the model matrix and color of every sphere once, then draw them all with one call
+        void UpdateInstances(const ObjectInstance* instances, size_t count);
+        void RenderInstances();
+
     private:
         void BuildVertices();
 
@@ -59,6 +63,13 @@ namespace Visualization
         GLuint m_viewIndex;
         GLuint m_projectionIndex;
 
+        // Instanced rendering objects
+        GLuint m_instancedShaderProgram = 0;
+        GLuint m_instanceBufferObject = 0;
+        GLuint m_instancedViewIndex = 0;
+        GLuint m_instancedProjectionIndex = 0;
+        GLsizei m_instanceCount = 0;
+
         GLuint m_colorIndex;
     };
 }
\ No newline at end of file
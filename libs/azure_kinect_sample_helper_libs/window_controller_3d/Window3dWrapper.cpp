@@ -4,12 +4,81 @@
 #include "Window3dWrapper.h"
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
 #include <k4a/k4a.h>
 #include <k4abt.h>
 
 #include "Utilities.h"
 
 const float MillimeterToMeter = 0.001f;
+const linmath::vec4 DefaultPointCloudColor = { 0.8f, 0.8f, 0.8f, 0.6f };
+const size_t BodyIndexColorCount = 256;
+
+const char XYDepthTableMagic[8] = { 'A', 'K', 'D', 'C', 'X', 'Y', 'T', 'B' };
+const uint32_t XYDepthTableVersion = 1;
+
+// Header of a cached XY depth table, followed by width * height pairs of floats
+struct XYDepthTableHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Width;
+    uint32_t Height;
+    uint64_t CalibrationHash;
+};
+
+// FNV-1a hash of what the XY depth table depends on: the depth mode and the depth camera resolution and intrinsics
+uint64_t HashXYDepthTableCalibration(const k4a_calibration_t& sensorCalibration)
+{
+    const k4a_calibration_camera_t& depthCamera = sensorCalibration.depth_camera_calibration;
+    const k4a_calibration_intrinsics_t& intrinsics = depthCamera.intrinsics;
+    const uint32_t fields[] = {
+        static_cast<uint32_t>(sensorCalibration.depth_mode),
+        static_cast<uint32_t>(depthCamera.resolution_width),
+        static_cast<uint32_t>(depthCamera.resolution_height),
+        static_cast<uint32_t>(intrinsics.type),
+        intrinsics.parameter_count };
+
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    hashBytes(fields, sizeof(fields));
+    hashBytes(intrinsics.parameters.v, sizeof(intrinsics.parameters.v));
+    hashBytes(&depthCamera.metric_radius, sizeof(depthCamera.metric_radius));
+    return hash;
+}
+
+// Cached tables are kept in the temporary directory. Returns an empty name if there is none.
+std::string GetXYDepthTableCacheFileName(uint64_t calibrationHash)
+{
+    std::error_code error;
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path(error);
+    if (error)
+    {
+        return std::string();
+    }
+
+    cacheDirectory /= "AzureKinectDataCollection";
+    std::filesystem::create_directories(cacheDirectory, error);
+    if (error)
+    {
+        return std::string();
+    }
+
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "xy_table_%016llx.bin", static_cast<unsigned long long>(calibrationHash));
+    return (cacheDirectory / fileName).string();
+}
 
 void ConvertMillimeterToMeter(k4a_float3_t positionInMM, linmath::vec3 outPositionInMeter)
 {
@@ -71,6 +140,7 @@ void Window3dWrapper::SetKeyCallback(
 void Window3dWrapper::Delete()
 {
     m_window3d.Delete();
+    ReleaseHeldImages();
 
     if (m_transformationHandle != nullptr)
     {
@@ -85,13 +155,14 @@ void Window3dWrapper::Delete()
     }
 }
 
-void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Color> pointCloudColors)
+void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, const std::vector<Color>& pointCloudColors)
 {
-    m_pointCloudUpdated = true;
-    VERIFY(k4a_transformation_depth_image_to_point_cloud(m_transformationHandle,
-        depthImage,
-        K4A_CALIBRATION_TYPE_DEPTH,
-        m_pointCloudImage), "Transform depth image to point clouds failed!");
+    if (m_decimation == Visualization::PointCloudDecimation::SkeletonOnly)
+    {
+        return;
+    }
+
+    TransformDepthImage(depthImage, Visualization::PointCloudVertexFormat::Float);
 
     int width = k4a_image_get_width_pixels(m_pointCloudImage);
     int height = k4a_image_get_height_pixels(m_pointCloudImage);
@@ -114,7 +185,8 @@ void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Colo
                 continue;
             }
 
-            linmath::vec4 color = { 0.8f, 0.8f, 0.8f, 0.6f };
+            linmath::vec4 color;
+            linmath::vec4_copy(color, DefaultPointCloudColor);
             linmath::ivec2 pixelLocation = { w, h };
 
             if (pointCloudColors.size() > 0)
@@ -124,17 +196,111 @@ void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Colo
 
             linmath::vec3 positionInMeter;
             ConvertMillimeterToMeter(position, positionInMeter);
-            Visualization::PointCloudVertex pointCloud;
+            Visualization::PointCloudVertex& pointCloud = m_pointClouds[m_pointCloudCount++];
             linmath::vec3_copy(pointCloud.Position, positionInMeter);
             linmath::vec4_copy(pointCloud.Color, color);
             pointCloud.PixelLocation[0] = pixelLocation[0];
             pointCloud.PixelLocation[1] = pixelLocation[1];
+        }
+    }
+
+    m_pointCloudCount = m_pointCloudDecimator.Decimate(m_pointClouds.data(), m_pointCloudCount, nullptr, width);
+    HoldImage(m_depthImage, depthImage);
+}
+
+void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, k4a_image_t bodyIndexMap, const std::vector<Color>& bodyIndexColors)
+{
+    if (m_decimation == Visualization::PointCloudDecimation::SkeletonOnly)
+    {
+        return;
+    }
+
+    // Blend each palette color with the point cloud color once, instead of once per point
+    const uint8_t* bodyIndexMapBuffer = nullptr;
+    for (size_t i = 0; i < BodyIndexColorCount; i++)
+    {
+        linmath::vec4_copy(m_bodyIndexVertexColors[i], DefaultPointCloudColor);
+    }
+    if (bodyIndexMap != nullptr && bodyIndexColors.size() >= BodyIndexColorCount)
+    {
+        bodyIndexMapBuffer = k4a_image_get_buffer(bodyIndexMap);
+        for (size_t i = 0; i < BodyIndexColorCount; i++)
+        {
+            BlendBodyColor(m_bodyIndexVertexColors[i], bodyIndexColors[i]);
+        }
+    }
+
+    // The vertex shader unprojects the depth image with the XY table, so the images are only kept for Render
+    if (m_enableGpuUnprojection && !m_xyDepthTable.empty() && m_decimation != Visualization::PointCloudDecimation::VoxelGrid)
+    {
+        m_pointCloudUpdated = true;
+        m_pointCloudOnGpu = true;
+        m_pointCloudCount = 0;
+        HoldImage(m_depthImage, depthImage);
+        HoldImage(m_bodyIndexImage, bodyIndexMapBuffer != nullptr ? bodyIndexMap : nullptr);
+        return;
+    }
 
-            m_pointClouds.push_back(pointCloud);
+    TransformDepthImage(depthImage, m_vertexFormat);
+
+    uint32_t width = static_cast<uint32_t>(k4a_image_get_width_pixels(m_pointCloudImage));
+    uint32_t height = static_cast<uint32_t>(k4a_image_get_height_pixels(m_pointCloudImage));
+    if (m_vertexFormat == Visualization::PointCloudVertexFormat::Packed)
+    {
+        for (size_t i = 0; i < BodyIndexColorCount; i++)
+        {
+            m_bodyIndexPackedColors[i] = Visualization::PackPointCloudColor(m_bodyIndexVertexColors[i]);
         }
+
+        m_pointCloudCount = Visualization::BuildPackedPointCloudVertices(
+            (const int16_t*)k4a_image_get_buffer(m_pointCloudImage),
+            bodyIndexMapBuffer,
+            m_bodyIndexPackedColors,
+            Visualization::PackPointCloudColor(DefaultPointCloudColor),
+            width,
+            height,
+            m_packedPointClouds.data());
+        m_pointCloudCount = m_pointCloudDecimator.Decimate(m_packedPointClouds.data(), m_pointCloudCount, bodyIndexMapBuffer, width);
+
+        HoldImage(m_depthImage, depthImage);
+        return;
     }
 
-    UpdateDepthBuffer(depthImage);
+    m_pointCloudCount = Visualization::BuildPointCloudVertices(
+        m_pointCloudKernel,
+        (const int16_t*)k4a_image_get_buffer(m_pointCloudImage),
+        bodyIndexMapBuffer,
+        m_bodyIndexVertexColors,
+        DefaultPointCloudColor,
+        width,
+        height,
+        m_pointClouds.data());
+    m_pointCloudCount = m_pointCloudDecimator.Decimate(m_pointClouds.data(), m_pointCloudCount, bodyIndexMapBuffer, width);
+
+    HoldImage(m_depthImage, depthImage);
+}
+
+void Window3dWrapper::TransformDepthImage(k4a_image_t depthImage, Visualization::PointCloudVertexFormat vertexFormat)
+{
+    m_pointCloudUpdated = true;
+    m_pointCloudOnGpu = false;
+    m_pointCloudFormat = vertexFormat;
+    VERIFY(k4a_transformation_depth_image_to_point_cloud(m_transformationHandle,
+        depthImage,
+        K4A_CALIBRATION_TYPE_DEPTH,
+        m_pointCloudImage), "Transform depth image to point clouds failed!");
+
+    // Vertices are written in place, so the list always has room for every pixel and only its count changes
+    size_t pixelCount = static_cast<size_t>(k4a_image_get_width_pixels(m_pointCloudImage)) * k4a_image_get_height_pixels(m_pointCloudImage);
+    if (vertexFormat == Visualization::PointCloudVertexFormat::Packed && m_packedPointClouds.size() < pixelCount)
+    {
+        m_packedPointClouds.resize(pixelCount);
+    }
+    else if (vertexFormat == Visualization::PointCloudVertexFormat::Float && m_pointClouds.size() < pixelCount)
+    {
+        m_pointClouds.resize(pixelCount);
+    }
+    m_pointCloudCount = 0;
 }
 
 void Window3dWrapper::CleanJointsAndBones()
@@ -208,11 +374,30 @@ void Window3dWrapper::AddBody(const k4abt_body_t& body, Color color)
 
 void Window3dWrapper::Render()
 {
-    if (m_pointCloudUpdated || m_pointClouds.size() != 0)
+    if ((m_pointCloudUpdated || m_pointCloudCount != 0) && m_depthImage != nullptr)
     {
-        m_window3d.UpdatePointClouds(m_pointClouds.data(), (uint32_t)m_pointClouds.size(), m_depthBuffer.data(), m_depthWidth, m_depthHeight);
-        m_pointClouds.clear();
+        // The uploads read the SDK buffers before returning, so the images are released right after
+        const uint16_t* depthFrame = reinterpret_cast<const uint16_t*>(k4a_image_get_buffer(m_depthImage));
+        if (m_pointCloudOnGpu)
+        {
+            m_window3d.UpdateDepthPointClouds(
+                depthFrame,
+                m_bodyIndexImage != nullptr ? k4a_image_get_buffer(m_bodyIndexImage) : nullptr,
+                m_bodyIndexVertexColors,
+                m_depthWidth,
+                m_depthHeight);
+        }
+        else if (m_pointCloudFormat == Visualization::PointCloudVertexFormat::Packed)
+        {
+            m_window3d.UpdatePointClouds(m_packedPointClouds.data(), m_pointCloudCount, depthFrame, m_depthWidth, m_depthHeight);
+        }
+        else
+        {
+            m_window3d.UpdatePointClouds(m_pointClouds.data(), m_pointCloudCount, depthFrame, m_depthWidth, m_depthHeight);
+        }
+        m_pointCloudCount = 0;
         m_pointCloudUpdated = false;
+        ReleaseHeldImages();
     }
 
     m_window3d.Render();
@@ -237,6 +422,27 @@ void Window3dWrapper::SetJointFrameVisualization(bool enableJointFrameVisualizat
     m_window3d.SetSkeletonRenderMode(skeletonRenderMode);
 }
 
+void Window3dWrapper::SetGpuUnprojection(bool enableGpuUnprojection)
+{
+    m_enableGpuUnprojection = enableGpuUnprojection;
+}
+
+void Window3dWrapper::SetPointCloudVertexFormat(Visualization::PointCloudVertexFormat vertexFormat)
+{
+    m_vertexFormat = vertexFormat;
+}
+
+void Window3dWrapper::SetPointCloudDecimation(Visualization::PointCloudDecimation decimation, uint32_t stride, float voxelSize)
+{
+    m_decimation = decimation;
+    m_pointCloudDecimator.SetDecimation(decimation, stride, voxelSize);
+
+    // Built vertices are decimated by m_pointCloudDecimator, unprojected depth frames by the vertex shader
+    m_window3d.SetPointCloudDecimation(decimation == Visualization::PointCloudDecimation::Stride ? stride : 1,
+        decimation == Visualization::PointCloudDecimation::Foreground);
+    m_window3d.SetPointCloudRendering(decimation != Visualization::PointCloudDecimation::SkeletonOnly);
+}
+
 void Window3dWrapper::SetFloorRendering(bool enableFloorRendering, float floorPositionX, float floorPositionY, float floorPositionZ)
 {
     linmath::vec3 position = { floorPositionX, floorPositionY, floorPositionZ };
@@ -267,7 +473,10 @@ void Window3dWrapper::InitializeCalibration(const k4a_calibration_t& sensorCalib
     m_depthHeight = static_cast<uint32_t>(sensorCalibration.depth_camera_calibration.resolution_height);
 
     // Cache the 2D to 3D unprojection table
+    auto startTime = std::chrono::steady_clock::now();
     EXIT_IF(!CreateXYDepthTable(sensorCalibration), "Create XY Depth Table failed!");
+    printf("XY depth table (%ux%u) ready in %.1f ms\n", m_depthWidth, m_depthHeight,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
     m_window3d.InitializePointCloudRenderer(
         true,   // Enable point cloud shading for better visualization effect
         reinterpret_cast<float*>(m_xyDepthTable.data()),
@@ -300,58 +509,178 @@ void Window3dWrapper::BlendBodyColor(linmath::vec4 color, Color bodyColor)
     color[2] = bodyColor.b * instanceAlpha + color[2] * darkenRatio;
 }
 
-void Window3dWrapper::UpdateDepthBuffer(k4a_image_t depthFrame)
+void Window3dWrapper::HoldImage(k4a_image_t& heldImage, k4a_image_t image)
+{
+    // Reference the new image first, in case it is the one already held
+    if (image != nullptr)
+    {
+        k4a_image_reference(image);
+    }
+    if (heldImage != nullptr)
+    {
+        k4a_image_release(heldImage);
+    }
+    heldImage = image;
+}
+
+void Window3dWrapper::ReleaseHeldImages()
+{
+    HoldImage(m_depthImage, nullptr);
+    HoldImage(m_bodyIndexImage, nullptr);
+}
+
+bool Window3dWrapper::CreateXYDepthTable(const k4a_calibration_t& sensorCalibration)
 {
-    int width = k4a_image_get_width_pixels(depthFrame);
-    int height = k4a_image_get_height_pixels(depthFrame);
-    uint16_t* depthFrameBuffer = (uint16_t*)k4a_image_get_buffer(depthFrame);
-    m_depthBuffer.assign(depthFrameBuffer, depthFrameBuffer + width * height);
+    uint64_t calibrationHash = HashXYDepthTableCalibration(sensorCalibration);
+    std::string cacheFileName = GetXYDepthTableCacheFileName(calibrationHash);
+    if (!cacheFileName.empty() && LoadXYDepthTable(cacheFileName, calibrationHash))
+    {
+        printf("Loaded XY depth table from %s\n", cacheFileName.c_str());
+        return true;
+    }
+
+    if (!BuildXYDepthTable(sensorCalibration))
+    {
+        return false;
+    }
+
+    if (!cacheFileName.empty())
+    {
+        SaveXYDepthTable(cacheFileName, calibrationHash);
+    }
+    return true;
 }
 
-bool Window3dWrapper::CreateXYDepthTable(const k4a_calibration_t & sensorCalibration)
+bool Window3dWrapper::BuildXYDepthTable(const k4a_calibration_t& sensorCalibration)
 {
     int width = sensorCalibration.depth_camera_calibration.resolution_width;
     int height = sensorCalibration.depth_camera_calibration.resolution_height;
 
     m_xyDepthTable.resize(width * height);
 
-    auto xyTablePtr = m_xyDepthTable.begin();
+    // Rows are independent, so each thread unprojects every threadCount-th row
+    int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+    else if (threadCount > height)
+    {
+        threadCount = height;
+    }
 
-    k4a_float3_t pt3;
-    for (int h = 0; h < height; h++)
+    std::atomic<bool> failed(false);
+    auto buildRows = [&](int firstRow)
     {
-        for (int w = 0; w < width; w++)
+        k4a_float3_t pt3;
+        for (int h = firstRow; h < height && !failed; h += threadCount)
         {
-            k4a_float2_t pt = { static_cast<float>(w), static_cast<float>(h) };
-            int valid = 0;
-            k4a_result_t result = k4a_calibration_2d_to_3d(&sensorCalibration,
-                &pt,
-                1.f,
-                K4A_CALIBRATION_TYPE_DEPTH,
-                K4A_CALIBRATION_TYPE_DEPTH,
-                &pt3,
-                &valid);
-            if (result != K4A_RESULT_SUCCEEDED)
+            XY* xyTablePtr = m_xyDepthTable.data() + h * width;
+            for (int w = 0; w < width; w++)
             {
-                return false;
+                k4a_float2_t pt = { static_cast<float>(w), static_cast<float>(h) };
+                int valid = 0;
+                k4a_result_t result = k4a_calibration_2d_to_3d(&sensorCalibration,
+                    &pt,
+                    1.f,
+                    K4A_CALIBRATION_TYPE_DEPTH,
+                    K4A_CALIBRATION_TYPE_DEPTH,
+                    &pt3,
+                    &valid);
+                if (result != K4A_RESULT_SUCCEEDED)
+                {
+                    failed = true;
+                    return;
+                }
+
+                if (valid == 0)
+                {
+                    // Set the invalid xy table to be (0, 0)
+                    xyTablePtr->x = 0.f;
+                    xyTablePtr->y = 0.f;
+                }
+                else
+                {
+                    xyTablePtr->x = pt3.xyz.x;
+                    xyTablePtr->y = pt3.xyz.y;
+                }
+
+                ++xyTablePtr;
             }
+        }
+    };
 
-            if (valid == 0)
-            {
-                // Set the invalid xy table to be (0, 0)
-                xyTablePtr->x = 0.f;
-                xyTablePtr->y = 0.f;
-            }
-            else
-            {
-                xyTablePtr->x = pt3.xyz.x;
-                xyTablePtr->y = pt3.xyz.y;
-            }
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(buildRows, i);
+    }
+    buildRows(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
 
-            ++xyTablePtr;
-        }
+    return !failed;
+}
+
+bool Window3dWrapper::LoadXYDepthTable(const std::string& cacheFileName, uint64_t calibrationHash)
+{
+    FILE* cacheFile = nullptr;
+    if (fopen_s(&cacheFile, cacheFileName.c_str(), "rb") != 0)
+    {
+        return false;
     }
 
-    return true;
+    XYDepthTableHeader header;
+    bool loaded = fread(&header, sizeof(header), 1, cacheFile) == 1 &&
+        memcmp(header.Magic, XYDepthTableMagic, sizeof(header.Magic)) == 0 &&
+        header.Version == XYDepthTableVersion &&
+        header.Width == m_depthWidth &&
+        header.Height == m_depthHeight &&
+        header.CalibrationHash == calibrationHash;
+
+    if (loaded)
+    {
+        size_t count = static_cast<size_t>(header.Width) * header.Height;
+        m_xyDepthTable.resize(count);
+        loaded = fread(m_xyDepthTable.data(), sizeof(XY), count, cacheFile) == count;
+    }
+
+    fclose(cacheFile);
+
+    if (!loaded)
+    {
+        m_xyDepthTable.clear();
+    }
+    return loaded;
+}
+
+// Failing to write the cache only means the table is built again next time
+void Window3dWrapper::SaveXYDepthTable(const std::string& cacheFileName, uint64_t calibrationHash) const
+{
+    FILE* cacheFile = nullptr;
+    if (fopen_s(&cacheFile, cacheFileName.c_str(), "wb") != 0)
+    {
+        return;
+    }
+
+    XYDepthTableHeader header = {};
+    memcpy(header.Magic, XYDepthTableMagic, sizeof(header.Magic));
+    header.Version = XYDepthTableVersion;
+    header.Width = m_depthWidth;
+    header.Height = m_depthHeight;
+    header.CalibrationHash = calibrationHash;
+
+    size_t count = m_xyDepthTable.size();
+    bool saved = fwrite(&header, sizeof(header), 1, cacheFile) == 1 &&
+        fwrite(m_xyDepthTable.data(), sizeof(XY), count, cacheFile) == count;
+
+    fclose(cacheFile);
+
+    if (!saved)
+    {
+        remove(cacheFileName.c_str());
+    }
 }
 
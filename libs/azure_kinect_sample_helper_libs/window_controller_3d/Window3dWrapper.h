@@ -7,6 +7,8 @@
 #include <BodyTrackingHelpers.h>
 
 #include "WindowController3d.h"
+#include "PointCloudVertexBuilder.h"
+#include "PointCloudDecimator.h"
 
 
 // This is a wrapper library that convert the types from the k4abt types to the window3d visualization library types
@@ -37,7 +39,12 @@ public:
 
     void Delete();
 
-    void UpdatePointClouds(k4a_image_t depthImage, std::vector<Color> pointCloudColors = std::vector<Color>());
+    void UpdatePointClouds(k4a_image_t depthImage, const std::vector<Color>& pointCloudColors = std::vector<Color>());
+
+    // Color each point with the palette entry of its body index map value. The palette needs an entry for
+    // every possible value (256), so it can be built once per frame from the body list instead of per pixel.
+    // With GPU unprojection, the depth and body index images are uploaded as they are and no vertices are built.
+    void UpdatePointClouds(k4a_image_t depthImage, k4a_image_t bodyIndexMap, const std::vector<Color>& bodyIndexColors);
 
     void CleanJointsAndBones();
 
@@ -60,21 +67,59 @@ public:
     void SetLayout3d(Visualization::Layout3d layout3d);
     void SetJointFrameVisualization(bool enableJointFrameVisualization);
 
+    // Unproject body index colored point clouds in the vertex shader instead of transforming them on the CPU.
+    // Enabled by default; only used when the wrapper was created with a calibration.
+    void SetGpuUnprojection(bool enableGpuUnprojection);
+
+    // Layout of the vertices built for body index colored point clouds without GPU unprojection. Packed by default.
+    void SetPointCloudVertexFormat(Visualization::PointCloudVertexFormat vertexFormat);
+
+    // Draw fewer points for slower machines. Stride keeps every Nth pixel of every Nth row, VoxelGrid keeps one point
+    // per cube of the voxel size (in meters), Foreground keeps the points of bodies and SkeletonOnly skips all point
+    // cloud work. Stride and Foreground are done in the vertex shader with GPU unprojection; VoxelGrid always builds
+    // vertices on the CPU, since it needs their positions.
+    void SetPointCloudDecimation(Visualization::PointCloudDecimation decimation, uint32_t stride = 2, float voxelSize = 0.02f);
+
 private:
     void InitializeCalibration(const k4a_calibration_t& sensorCalibration);
 
+    void TransformDepthImage(k4a_image_t depthImage, Visualization::PointCloudVertexFormat vertexFormat);
+
     void BlendBodyColor(linmath::vec4 color, Color bodyColor);
 
-    void UpdateDepthBuffer(k4a_image_t depthImage);
+    // Keep a reference to an image until Render uploads it, replacing the image held before
+    void HoldImage(k4a_image_t& heldImage, k4a_image_t image);
+
+    void ReleaseHeldImages();
 
+    // Load the table from the cache, or build it with a thread per group of rows and cache it
     bool CreateXYDepthTable(const k4a_calibration_t& sensorCalibration);
 
+    bool BuildXYDepthTable(const k4a_calibration_t& sensorCalibration);
+
+    // The cache file holds the table of one set of depth camera intrinsics and depth mode, identified by their hash
+    bool LoadXYDepthTable(const std::string& cacheFileName, uint64_t calibrationHash);
+    void SaveXYDepthTable(const std::string& cacheFileName, uint64_t calibrationHash) const;
+
 private:
     Visualization::WindowController3d m_window3d;
 
     bool m_pointCloudUpdated = false;
-    std::vector<uint16_t> m_depthBuffer;
+    bool m_enableGpuUnprojection = true;
+    bool m_pointCloudOnGpu = false;
+    Visualization::PointCloudVertexFormat m_vertexFormat = Visualization::PointCloudVertexFormat::Packed;
+    Visualization::PointCloudVertexFormat m_pointCloudFormat = Visualization::PointCloudVertexFormat::Float;
+    Visualization::PointCloudDecimation m_decimation = Visualization::PointCloudDecimation::Full;
+    Visualization::PointCloudDecimator m_pointCloudDecimator;
+    // Images of the last update, uploaded by Render straight from the SDK buffers instead of copies
+    k4a_image_t m_depthImage = nullptr;
+    k4a_image_t m_bodyIndexImage = nullptr;
     std::vector<Visualization::PointCloudVertex> m_pointClouds;
+    std::vector<Visualization::PackedPointCloudVertex> m_packedPointClouds;
+    uint32_t m_pointCloudCount = 0;
+    Visualization::PointCloudKernel m_pointCloudKernel = Visualization::GetFastestPointCloudKernel();
+    linmath::vec4 m_bodyIndexVertexColors[256];
+    uint32_t m_bodyIndexPackedColors[256];
 
     struct XY
     {
@@ -235,6 +235,24 @@ void WindowController3d::UpdatePointClouds(
     m_pointCloudRenderer.UpdatePointClouds(m_window, point3d, numPoints, depthFrame, width, height, useTestPointClouds);
 }
 
+void WindowController3d::UpdatePointClouds(
+    const PackedPointCloudVertex* point3d,
+    uint32_t numPoints,
+    const uint16_t* depthFrame,
+    uint32_t width, uint32_t height)
+{
+    m_pointCloudRenderer.UpdatePointClouds(m_window, point3d, numPoints, depthFrame, width, height);
+}
+
+void WindowController3d::UpdateDepthPointClouds(
+    const uint16_t* depthFrame,
+    const uint8_t* bodyIndexMap,
+    const linmath::vec4* bodyIndexColors,
+    uint32_t width, uint32_t height)
+{
+    m_pointCloudRenderer.UpdateDepthPointClouds(m_window, depthFrame, bodyIndexMap, bodyIndexColors, width, height);
+}
+
 void WindowController3d::CleanJointsAndBones()
 {
     m_skeletonRenderer.CleanJointsAndBones();
@@ -286,7 +304,10 @@ void WindowController3d::RenderScene(ViewControl& viewControl, Viewport viewport
     if (m_skeletonRenderMode == SkeletonRenderMode::SkeletonOverlay ||
         m_skeletonRenderMode == SkeletonRenderMode::SkeletonOverlayWithJointFrame)
     {
-        m_pointCloudRenderer.Render(viewport.width, viewport.height);
+        if (m_enablePointCloudRendering)
+        {
+            m_pointCloudRenderer.Render(viewport.width, viewport.height);
+        }
 
         glClear(GL_DEPTH_BUFFER_BIT);
         m_skeletonRenderer.Render();
@@ -294,7 +315,10 @@ void WindowController3d::RenderScene(ViewControl& viewControl, Viewport viewport
     else
     {
         m_skeletonRenderer.Render();
-        m_pointCloudRenderer.Render(viewport.width, viewport.height);
+        if (m_enablePointCloudRendering)
+        {
+            m_pointCloudRenderer.Render(viewport.width, viewport.height);
+        }
     }
 
     // Render Camera Pivot Point when interacting with the view control.
@@ -414,6 +438,18 @@ void WindowController3d::ChangePointCloudSize(float pointCloudSize)
     m_pointCloudRenderer.ChangePointCloudSize(pointCloudSize);
 }
 
+void WindowController3d::SetPointCloudDecimation(uint32_t pixelStride, bool foregroundOnly)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_pointCloudRenderer.SetDecimation(pixelStride, foregroundOnly);
+}
+
+void WindowController3d::SetPointCloudRendering(bool enablePointCloudRendering)
+{
+    m_enablePointCloudRendering = enablePointCloudRendering;
+}
+
 void WindowController3d::SetFloorRendering(bool enableFloorRendering, linmath::vec3 floorPosition, linmath::quaternion floorOrientation)
 {
     if (!m_enableFloorRendering && enableFloorRendering)
@@ -66,6 +66,19 @@ namespace Visualization
             uint32_t width, uint32_t height,
             bool useTestPointClouds = false);
 
+        void UpdatePointClouds(
+            const Visualization::PackedPointCloudVertex* point3d,
+            uint32_t numPoints,
+            const uint16_t* depthFrame,
+            uint32_t width, uint32_t height);
+
+        // Unproject the depth frame on the GPU instead of uploading vertices. Needs the DepthXYTable.
+        void UpdateDepthPointClouds(
+            const uint16_t* depthFrame,
+            const uint8_t* bodyIndexMap,
+            const linmath::vec4* bodyIndexColors,
+            uint32_t width, uint32_t height);
+
         void CleanJointsAndBones();
 
         void AddJoint(const Visualization::Joint& joint);
@@ -89,6 +102,12 @@ namespace Visualization
 
         void ChangePointCloudSize(float pointCloudSize);
 
+        // Decimate unprojected depth point clouds in the vertex shader, see PointCloudRenderer::SetDecimation
+        void SetPointCloudDecimation(uint32_t pixelStride, bool foregroundOnly);
+
+        // Skip drawing the point cloud, so only skeletons and the floor are drawn
+        void SetPointCloudRendering(bool enablePointCloudRendering);
+
         void SetFloorRendering(bool enableFloorRendering, linmath::vec3 floorPosition, linmath::quaternion floorOrientation);
 
         // Methods to set external callback functions
@@ -118,6 +137,7 @@ namespace Visualization
         Layout3d m_layout3d = Layout3d::OnlyMainView;
         SkeletonRenderMode m_skeletonRenderMode = SkeletonRenderMode::DefaultRender;
         bool m_enableFloorRendering = false;
+        bool m_enablePointCloudRendering = true;
 
         // View Controls
         ViewControl m_viewControl;
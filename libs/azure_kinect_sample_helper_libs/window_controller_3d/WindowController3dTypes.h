@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include "linmath.h"
 
 namespace Visualization
@@ -14,6 +16,32 @@ namespace Visualization
         linmath::ivec2 PixelLocation;   // Pixel location of point cloud in the depth map (w, h)
     };
 
+    // Point cloud vertex in 16 bytes instead of the 36 of PointCloudVertex, for uploading large point clouds
+    struct PackedPointCloudVertex
+    {
+        int16_t Position[4];            // The position in millimeters, as in the k4a point cloud image. The 4th value is padding.
+        uint8_t Color[4];               // RGBA, 0 to 255
+        uint16_t PixelLocation[2];      // Pixel location of point cloud in the depth map (w, h)
+    };
+    static_assert(sizeof(PackedPointCloudVertex) == 16, "PackedPointCloudVertex must stay 16 bytes");
+
+    // Vertex layout the point clouds are built and uploaded in
+    enum class PointCloudVertexFormat
+    {
+        Float,      // PointCloudVertex
+        Packed      // PackedPointCloudVertex
+    };
+
+    // Which points of the depth frame are drawn, to keep large point clouds from slowing down slower machines
+    enum class PointCloudDecimation
+    {
+        Full,           // Every valid depth pixel
+        Stride,         // Every Nth pixel of every Nth row
+        VoxelGrid,      // One point per occupied cube of the voxel size
+        Foreground,     // Only pixels that belong to a body in the body index map
+        SkeletonOnly    // No point cloud at all
+    };
+
     struct MonoVertex
     {
         linmath::vec3 Position;         // The position of the mono vertex specified in meters
@@ -27,6 +55,13 @@ namespace Visualization
         linmath::vec4 Color;
     };
 
+    // Per-instance data of an object drawn with instanced rendering
+    struct ObjectInstance
+    {
+        linmath::mat4x4 Model;
+        linmath::vec4 Color;            // Ignored by objects with vertex colors
+    };
+
     struct Joint
     {
         linmath::vec3 Position;          // The position of the joint specified in meters
@@ -9,6 +9,7 @@
  */
 
 #include "3DViewer.h"
+#include "SkeletonSession.h"
 
 int main(int argc, char* argv[]) {
     InputSettings inputSettings;
@@ -16,12 +17,38 @@ int main(int argc, char* argv[]) {
     // Run startup GUI if there are no command line arguments
     if((argc > 1 && ParseInputSettingsFromArg(argc, argv, inputSettings)) ||
        (argc == 1 && runStartupGUI(inputSettings))) {
-        // Either play the offline file or play from the device
-        if(inputSettings.Offline == true) {
-            PlayFile(inputSettings);
+        // Run the benchmark, export a skeleton file, process a batch of files, play the offline file, generate a synthetic session
+        // or play from the device
+        if(inputSettings.Benchmark == true) {
+            return RunBenchmark() ? 0 : 1;
+        }
+        else if(inputSettings.ExportCsv == true) {
+            return ExportSkeletonFile(inputSettings.InputFileName, inputSettings.OutputFileName, inputSettings.ExportFirstFrame,
+                                      inputSettings.ExportLastFrame, inputSettings.ExportBodyId, GetSkeletonCsvOptions(inputSettings),
+                                      inputSettings.AnglesFileName == "") ? 0 : 1;
+        }
+        else if(inputSettings.Batch == true) {
+            return RunBatch(inputSettings) != 0 ? 1 : 0;
+        }
+        else if(inputSettings.Offline == true || inputSettings.Synthetic == true) {
+            int processedFrames = inputSettings.Offline ? PlayFile(inputSettings) : PlaySynthetic(inputSettings);
+            if(processedFrames < 0) {
+                return 1;
+            }
+
+            // Report the frame count to the batch that started this session
+            if(inputSettings.FrameCountFileName != "" && !WriteFrameCountFile(inputSettings.FrameCountFileName, processedFrames)) {
+                return 1;
+            }
+
+            // Check the output against the expected one for regression runs
+            if(inputSettings.CompareFileName != "") {
+                return CompareCsvFiles(inputSettings.OutputFileName, inputSettings.CompareFileName) ? 0 : 1;
+            }
+            return 0;
         }
         else {
-            PlayFromDevice(inputSettings);
+            return PlayFromDevice(inputSettings) < 0 ? 1 : 0;
         }
     }
     else if(argc > 1) {
@@ -0,0 +1,152 @@
+/* Aden Prince
+ * HiMER Lab at U. of Illinois, Chicago
+ * Azure Kinect Data Collection
+ *
+ * regression.cpp
+ * Contains the comparison of a CSV output with an expected one, used to
+ * check that a deterministic session such as SYNTHETIC HEADLESS still
+ * produces the same rows.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include "3DViewer.h"
+
+// Numbers may differ by this much relative to their size, so expected files can be shared
+// between builds whose math libraries round the last digits differently
+const double REGRESSION_TOLERANCE = 1e-4;
+
+// Columns that depend on when the session ran instead of on its input
+const char* const REGRESSION_IGNORED_COLUMNS[] = {"System Timestamp (ns)"};
+
+// Rows reported before the comparison only counts further differences
+const size_t REGRESSION_MAX_REPORTED = 10;
+
+// Split a CSV row into cells. Quoted cells such as joint positions keep their commas and lose their quotes.
+std::vector<std::string> splitCsvRow(const std::string& row) {
+    std::vector<std::string> cells(1);
+    bool quoted = false;
+    for(char c : row) {
+        if(c == '"') {
+            quoted = !quoted;
+        }
+        else if(c == ',' && !quoted) {
+            cells.emplace_back();
+        }
+        else if(c != '\r') {
+            cells.back() += c;
+        }
+    }
+    return cells;
+}
+
+// Check if a character can start a number
+bool startsNumber(const char* text) {
+    return (*text >= '0' && *text <= '9') || ((*text == '-' || *text == '.') && text[1] >= '0' && text[1] <= '9');
+}
+
+// Check if two cells match, with numbers in them allowed to differ within the tolerance and the rest of the text the same
+bool cellsMatch(const std::string& cell, const std::string& expectedCell) {
+    const char* actual = cell.c_str();
+    const char* expected = expectedCell.c_str();
+    while(*actual != '\0' && *expected != '\0') {
+        if(startsNumber(actual) && startsNumber(expected)) {
+            char* actualEnd = NULL;
+            char* expectedEnd = NULL;
+            double actualValue = strtod(actual, &actualEnd);
+            double expectedValue = strtod(expected, &expectedEnd);
+            if(fabs(actualValue - expectedValue) > REGRESSION_TOLERANCE * std::max(1.0, fabs(expectedValue))) {
+                return false;
+            }
+            actual = actualEnd;
+            expected = expectedEnd;
+        }
+        else if(*actual++ != *expected++) {
+            return false;
+        }
+    }
+    return *actual == '\0' && *expected == '\0';
+}
+
+bool CompareCsvFiles(const std::string& fileName, const std::string& expectedFileName) {
+    std::ifstream file(fileName);
+    std::ifstream expectedFile(expectedFileName);
+    if(!file.is_open()) {
+        printf("Open file %s failed.\n", fileName.c_str());
+        return false;
+    }
+    if(!expectedFile.is_open()) {
+        printf("Open file %s failed.\n", expectedFileName.c_str());
+        return false;
+    }
+
+    // The columns have to be the same before rows can be compared
+    std::string header, expectedHeader;
+    std::getline(file, header);
+    std::getline(expectedFile, expectedHeader);
+    std::vector<std::string> columns = splitCsvRow(header);
+    if(columns != splitCsvRow(expectedHeader)) {
+        printf("Columns of %s differ from %s.\n", fileName.c_str(), expectedFileName.c_str());
+        return false;
+    }
+
+    std::vector<bool> ignored(columns.size(), false);
+    for(size_t i = 0; i < columns.size(); i++) {
+        for(const char* ignoredColumn : REGRESSION_IGNORED_COLUMNS) {
+            ignored[i] = ignored[i] || columns[i] == ignoredColumn;
+        }
+    }
+
+    size_t rowCount = 0;
+    size_t differentRows = 0;
+    std::string row, expectedRow;
+    while(true) {
+        bool hasRow = (bool) std::getline(file, row);
+        bool hasExpectedRow = (bool) std::getline(expectedFile, expectedRow);
+        if(!hasRow || !hasExpectedRow) {
+            if(hasRow || hasExpectedRow) {
+                printf("%s has %s rows than %s.\n", fileName.c_str(), hasRow ? "more" : "fewer", expectedFileName.c_str());
+                differentRows++;
+            }
+            break;
+        }
+        rowCount++;
+
+        std::vector<std::string> cells = splitCsvRow(row);
+        std::vector<std::string> expectedCells = splitCsvRow(expectedRow);
+        bool same = cells.size() == expectedCells.size();
+        size_t column = 0;
+        for(; same && column < cells.size(); column++) {
+            if(!(column < ignored.size() && ignored[column]) && !cellsMatch(cells[column], expectedCells[column])) {
+                same = false;
+                break;
+            }
+        }
+
+        if(!same) {
+            if(differentRows < REGRESSION_MAX_REPORTED) {
+                if(column < cells.size() && column < expectedCells.size()) {
+                    printf("Row %zu, column %s: %s, expected %s\n", rowCount, column < columns.size() ? columns[column].c_str() : "(extra)",
+                           cells[column].c_str(), expectedCells[column].c_str());
+                }
+                else {
+                    printf("Row %zu has %zu cells, expected %zu\n", rowCount, cells.size(), expectedCells.size());
+                }
+            }
+            differentRows++;
+        }
+    }
+
+    if(differentRows > 0) {
+        printf("Output %s differs from %s in %zu rows.\n", fileName.c_str(), expectedFileName.c_str(), differentRows);
+        return false;
+    }
+
+    printf("Output %s matches %s (%zu rows).\n", fileName.c_str(), expectedFileName.c_str(), rowCount);
+    return true;
+}